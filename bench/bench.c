@@ -0,0 +1,996 @@
+#include <tioc/tioc.h>
+#include <err.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Measures the per-record cost of the libtioc read and write paths.
+ *
+ * Each record consists of an unsigned value, a UUID and a string.  The write
+ * benchmark is run with 1..N threads, each thread writing to its own FILE, so
+ * that any process-wide serialisation inside the library shows up as a loss
+ * of scaling.
+ *
+ * malloc() and friends are wrapped so that the read benchmarks can also report
+ * the number of allocations that they make per record.
+ */
+
+struct job
+{
+    size_t records;
+    double seconds;
+    size_t allocations;
+    int rc;
+};
+
+/*
+ * glibc's own allocator, which the wrappers below forward to.
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void __libc_free(void *p);
+
+/*
+ * The number of allocations made by the whole process.
+ */
+static size_t allocations;
+
+void *malloc(size_t size)
+{
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(p, size);
+}
+
+void free(void *p)
+{
+    __libc_free(p);
+}
+
+/*
+ * Returns the current monotonic time in seconds.
+ */
+static double now(void);
+
+/*
+ * Writes job->records records to /dev/null.
+ */
+static void *write_job(void *data);
+
+/*
+ * Writes job->records records to /dev/null through a tioc_writer_t.
+ */
+static int writer_job(struct job *job);
+
+/*
+ * As writer_job(), but with labels created once by tioc_label_init().
+ */
+static int labels_job(struct job *job);
+
+/*
+ * As writer_job(), but writing to a temporary file, through a writer opened
+ * with tioc_writer_open_async() if async is set.
+ */
+static int file_job(struct job *job, int async);
+
+/*
+ * Writes job->records records to a temporary file and reads them back, timing
+ * only the read.
+ */
+static int read_job(struct job *job);
+
+/*
+ * Writes job->records records to memory and parses them back with a
+ * tioc_reader_t, timing only the parse.
+ */
+static int reader_job(struct job *job);
+
+/*
+ * As reader_job(), but with the records written in the encoding given, which
+ * is binary or checked.
+ */
+static int binary_job(struct job *job, tioc_encoding_t encoding);
+
+/*
+ * As reader_job(), but with the strings allocated from a tioc_arena_t that is
+ * reset every ARENA_BATCH records.
+ */
+static int arena_job(struct job *job);
+
+/*
+ * As reader_job(), but with the strings read into a tioc_string_t.
+ */
+static int small_job(struct job *job);
+
+/*
+ * As reader_job(), but with tioc_reader_expect_unsigned() failing on every
+ * record first.  If format is set, the failures go to a handler that discards
+ * them (so they are formatted); otherwise there is no handler.
+ */
+static int mismatch_job(struct job *job, int format);
+
+/*
+ * As reader_job(), but with tioc_reader_parse_parallel() on the number of
+ * threads specified, in four chunks per thread.
+ */
+static int parallel_job(struct job *job, unsigned threads);
+
+/*
+ * Parses a chunk for parallel_job(), counting its records.
+ */
+static int parse_chunk(tioc_reader_t *reader, size_t chunk, void *context);
+
+/*
+ * Adds a chunk's count to the total for parallel_job().
+ */
+static int merge_chunk(size_t chunk, void *context);
+
+/*
+ * An error handler that discards its messages.
+ */
+static void discard_error(tioc_error_t error, const char *message, void *c);
+
+/*
+ * The number of records read between resets of the arena.
+ */
+#define ARENA_BATCH 1000
+
+/*
+ * The number of chunks per thread in parallel_job().
+ */
+#define PARALLEL_CHUNKS 4
+
+/*
+ * The number of buffers of the writer in file_job(), when asynchronous.
+ */
+#define ASYNC_BUFFERS 4
+
+/*
+ * The record counts of parallel_job()'s chunks, and their total.
+ */
+struct counts
+{
+    size_t *chunks;
+    size_t total;
+};
+
+/*
+ * Runs the write benchmark on the number of threads specified and prints the
+ * result.
+ */
+static int run_writers(unsigned threads, size_t records);
+
+int main(int argc, const char *argv[])
+{
+    size_t records = 200000;
+    unsigned threads = 4, t;
+    struct job job;
+
+    if (argc > 1) records = strtoul(argv[1], NULL, 10);
+    if (argc > 2) threads = strtoul(argv[2], NULL, 10);
+
+    if (!records || !threads)
+    {
+        warnx("usage: tioc-bench [records] [threads]");
+        return EXIT_FAILURE;
+    }
+
+    for (t = 1; t <= threads; t *= 2)
+    {
+        if (-1 == run_writers(t, records)) return EXIT_FAILURE;
+    }
+
+    job.records = records;
+    if (-1 == writer_job(&job)) return EXIT_FAILURE;
+
+    printf
+    (
+        "writer 1 thread : %8.1f ns/record\n",
+        job.seconds * 1e9 / (double)records
+    );
+
+    if (-1 == labels_job(&job)) return EXIT_FAILURE;
+
+    printf
+    (
+        "labels 1 thread : %8.1f ns/record\n",
+        job.seconds * 1e9 / (double)records
+    );
+
+    if (-1 == file_job(&job, 0)) return EXIT_FAILURE;
+
+    printf
+    (
+        "file   sync     : %8.1f ns/record\n",
+        job.seconds * 1e9 / (double)records
+    );
+
+    if (-1 == file_job(&job, 1)) return EXIT_FAILURE;
+
+    printf
+    (
+        "file   async    : %8.1f ns/record\n",
+        job.seconds * 1e9 / (double)records
+    );
+
+    if (-1 == read_job(&job)) return EXIT_FAILURE;
+
+    printf
+    (
+        "read   1 thread : %8.1f ns/record\n",
+        job.seconds * 1e9 / (double)records
+    );
+
+    if (-1 == reader_job(&job)) return EXIT_FAILURE;
+
+    printf
+    (
+        "reader 1 thread : %8.1f ns/record, %6.3f allocations/record\n",
+        job.seconds * 1e9 / (double)records,
+        (double)job.allocations / (double)records
+    );
+
+    if (-1 == arena_job(&job)) return EXIT_FAILURE;
+
+    printf
+    (
+        "arena  1 thread : %8.1f ns/record, %6.3f allocations/record\n",
+        job.seconds * 1e9 / (double)records,
+        (double)job.allocations / (double)records
+    );
+
+    if (-1 == small_job(&job)) return EXIT_FAILURE;
+
+    printf
+    (
+        "small  1 thread : %8.1f ns/record, %6.3f allocations/record\n",
+        job.seconds * 1e9 / (double)records,
+        (double)job.allocations / (double)records
+    );
+
+    if (-1 == binary_job(&job, TIOC_ENCODING_BINARY)) return EXIT_FAILURE;
+
+    printf
+    (
+        "binary 1 thread : %8.1f ns/record\n",
+        job.seconds * 1e9 / (double)records
+    );
+
+    if (-1 == binary_job(&job, TIOC_ENCODING_CHECKED)) return EXIT_FAILURE;
+
+    printf
+    (
+        "checkd 1 thread : %8.1f ns/record\n",
+        job.seconds * 1e9 / (double)records
+    );
+
+    for (t = 1; t <= threads; t *= 2)
+    {
+        if (-1 == parallel_job(&job, t)) return EXIT_FAILURE;
+
+        printf
+        (
+            "parallel %2u thread%s: %8.1f ns/record\n",
+            t,
+            1 == t ? " " : "s",
+            job.seconds * 1e9 / (double)records
+        );
+    }
+
+    if (-1 == mismatch_job(&job, 1)) return EXIT_FAILURE;
+
+    printf
+    (
+        "expect mismatch, formatted : %8.1f ns/record\n",
+        job.seconds * 1e9 / (double)records
+    );
+
+    if (-1 == mismatch_job(&job, 0)) return EXIT_FAILURE;
+
+    printf
+    (
+        "expect mismatch, silenced  : %8.1f ns/record\n",
+        job.seconds * 1e9 / (double)records
+    );
+
+    return EXIT_SUCCESS;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int write_records(FILE *file, size_t records)
+{
+    size_t i;
+    uuid_t u;
+
+    memset(u, 0xab, sizeof(u));
+
+    for (i = 0; i < records; ++i)
+    {
+        if (-1 == write_unsigned(file, "timestamp", 1534466554ULL + i) ||
+            -1 == write_uuid(file, "id", u) ||
+            -1 == write_string(file, "name", "John"))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void *write_job(void *data)
+{
+    struct job *job = data;
+    FILE *file;
+    double start;
+
+    job->rc = -1;
+
+    if (!(file = fopen("/dev/null", "w")))
+    {
+        warn("fopen(/dev/null)");
+        return NULL;
+    }
+
+    start = now();
+    job->rc = write_records(file, job->records);
+    job->seconds = now() - start;
+
+    fclose(file);
+    return NULL;
+}
+
+static int run_writers(unsigned threads, size_t records)
+{
+    pthread_t *tids;
+    struct job *jobs;
+    unsigned i;
+    int rc = -1;
+    double total = 0;
+
+    tids = calloc(threads, sizeof(*tids));
+    jobs = calloc(threads, sizeof(*jobs));
+
+    if (!tids || !jobs)
+    {
+        warnx("calloc() failed.");
+        goto cleanup;
+    }
+
+    for (i = 0; i < threads; ++i)
+    {
+        jobs[i].records = records;
+        if (pthread_create(&tids[i], NULL, write_job, &jobs[i]))
+        {
+            warnx("pthread_create() failed.");
+            threads = i;
+            break;
+        }
+    }
+
+    for (i = 0; i < threads; ++i)
+    {
+        pthread_join(tids[i], NULL);
+        if (jobs[i].rc) goto cleanup;
+        if (jobs[i].seconds > total) total = jobs[i].seconds;
+    }
+
+    printf
+    (
+        "write %2u thread%s: %8.1f ns/record, %6.2f Mrecords/s aggregate\n",
+        threads,
+        1 == threads ? " " : "s",
+        total * 1e9 / (double)records,
+        (double)records * threads / total / 1e6
+    );
+
+    rc = 0;
+
+cleanup:
+    free(tids);
+    free(jobs);
+    return rc;
+}
+
+static int writer_job(struct job *job)
+{
+    tioc_writer_t *writer;
+    size_t i;
+    int fd;
+    uuid_t u;
+    double start;
+    int rc = -1;
+
+    memset(u, 0xab, sizeof(u));
+
+    if (-1 == (fd = open("/dev/null", O_WRONLY)))
+    {
+        warn("open(/dev/null)");
+        return -1;
+    }
+
+    if (!(writer = tioc_writer_open(fd, 0)))
+    {
+        close(fd);
+        return -1;
+    }
+
+    start = now();
+    for (i = 0; i < job->records; ++i)
+    {
+        if (-1 == tioc_writer_write_unsigned(writer, "timestamp",
+                    1534466554ULL + i) ||
+            -1 == tioc_writer_write_uuid(writer, "id", u) ||
+            -1 == tioc_writer_write_string(writer, "name", "John"))
+        {
+            goto cleanup;
+        }
+    }
+
+    if (-1 == tioc_writer_flush(writer)) goto cleanup;
+    job->seconds = now() - start;
+
+    rc = 0;
+
+cleanup:
+    if (-1 == tioc_writer_close(writer)) rc = -1;
+    return rc;
+}
+
+static int labels_job(struct job *job)
+{
+    tioc_writer_t *writer;
+    tioc_label_t timestamp, id, name;
+    size_t i;
+    int fd;
+    uuid_t u;
+    double start;
+    int rc = -1;
+
+    memset(u, 0xab, sizeof(u));
+
+    if (-1 == tioc_label_init(&timestamp, "timestamp") ||
+        -1 == tioc_label_init(&id, "id") ||
+        -1 == tioc_label_init(&name, "name"))
+    {
+        return -1;
+    }
+
+    if (-1 == (fd = open("/dev/null", O_WRONLY)))
+    {
+        warn("open(/dev/null)");
+        return -1;
+    }
+
+    if (!(writer = tioc_writer_open(fd, 0)))
+    {
+        close(fd);
+        return -1;
+    }
+
+    start = now();
+    for (i = 0; i < job->records; ++i)
+    {
+        if (-1 == tioc_writer_write_unsigned_l(writer, &timestamp,
+                    1534466554ULL + i) ||
+            -1 == tioc_writer_write_uuid_l(writer, &id, u) ||
+            -1 == tioc_writer_write_string_l(writer, &name, "John"))
+        {
+            goto cleanup;
+        }
+    }
+
+    if (-1 == tioc_writer_flush(writer)) goto cleanup;
+    job->seconds = now() - start;
+
+    rc = 0;
+
+cleanup:
+    if (-1 == tioc_writer_close(writer)) rc = -1;
+    return rc;
+}
+
+static int file_job(struct job *job, int async)
+{
+    tioc_writer_t *writer;
+    FILE *file;
+    size_t i;
+    int fd;
+    uuid_t u;
+    double start;
+    int rc = -1;
+
+    memset(u, 0xab, sizeof(u));
+
+    if (!(file = tmpfile()))
+    {
+        warn("tmpfile()");
+        return -1;
+    }
+
+    fd = dup(fileno(file));
+    fclose(file);
+
+    if (-1 == fd)
+    {
+        warn("dup()");
+        return -1;
+    }
+
+    if (async)
+    {
+        writer = tioc_writer_open_async(fd, 0, ASYNC_BUFFERS,
+                TIOC_ENCODING_TEXT, NULL, NULL);
+    }
+    else
+    {
+        writer = tioc_writer_open(fd, 0);
+    }
+
+    if (!writer)
+    {
+        close(fd);
+        return -1;
+    }
+
+    start = now();
+    for (i = 0; i < job->records; ++i)
+    {
+        if (-1 == tioc_writer_write_unsigned(writer, "timestamp",
+                    1534466554ULL + i) ||
+            -1 == tioc_writer_write_uuid(writer, "id", u) ||
+            -1 == tioc_writer_write_string(writer, "name", "John"))
+        {
+            goto cleanup;
+        }
+    }
+
+    if (-1 == tioc_writer_flush(writer)) goto cleanup;
+    job->seconds = now() - start;
+
+    rc = 0;
+
+cleanup:
+    if (-1 == tioc_writer_close(writer)) rc = -1;
+    return rc;
+}
+
+static int read_job(struct job *job)
+{
+    FILE *file;
+    size_t i;
+    unsigned long long n;
+    uuid_t u;
+    char *s;
+    double start;
+    int rc = -1;
+
+    if (!(file = tmpfile()))
+    {
+        warn("tmpfile()");
+        return -1;
+    }
+
+    if (-1 == write_records(file, job->records)) goto cleanup;
+    rewind(file);
+
+    start = now();
+    for (i = 0; i < job->records; ++i)
+    {
+        if (-1 == read_unsigned(file, "timestamp", &n) ||
+            -1 == read_uuid(file, "id", u) ||
+            -1 == read_string(file, "name", &s))
+        {
+            goto cleanup;
+        }
+        free(s);
+    }
+    job->seconds = now() - start;
+
+    rc = 0;
+
+cleanup:
+    fclose(file);
+    return rc;
+}
+
+static int reader_job(struct job *job)
+{
+    FILE *file;
+    char *data = NULL;
+    size_t size = 0, i;
+    tioc_reader_t *reader = NULL;
+    unsigned long long n;
+    uuid_t u;
+    char *s;
+    double start;
+    int rc = -1;
+
+    if (!(file = open_memstream(&data, &size)))
+    {
+        warn("open_memstream()");
+        return -1;
+    }
+
+    rc = write_records(file, job->records);
+    if (EOF == fclose(file)) rc = -1;
+    if (-1 == rc) goto cleanup;
+
+    rc = -1;
+    if (!(reader = tioc_reader_open(data, size))) goto cleanup;
+
+    job->allocations = allocations;
+    start = now();
+    for (i = 0; i < job->records; ++i)
+    {
+        if (-1 == tioc_reader_read_unsigned(reader, "timestamp", &n) ||
+            -1 == tioc_reader_read_uuid(reader, "id", u) ||
+            -1 == tioc_reader_read_string(reader, "name", &s))
+        {
+            goto cleanup;
+        }
+        free(s);
+    }
+    job->seconds = now() - start;
+    job->allocations = allocations - job->allocations;
+
+    rc = 0;
+
+cleanup:
+    tioc_reader_close(reader);
+    free(data);
+    return rc;
+}
+
+static int binary_job(struct job *job, tioc_encoding_t encoding)
+{
+    FILE *file;
+    char *data = NULL;
+    long size;
+    size_t i;
+    tioc_writer_t *writer;
+    tioc_reader_t *reader = NULL;
+    unsigned long long n;
+    uuid_t u;
+    char *s;
+    double start;
+    int rc = -1;
+
+    memset(u, 0xab, sizeof(u));
+
+    if (!(file = tmpfile()))
+    {
+        warn("tmpfile()");
+        return -1;
+    }
+
+    if (!(writer = tioc_writer_open_encoding(dup(fileno(file)), 0,
+                    encoding)))
+    {
+        goto cleanup;
+    }
+
+    for (i = 0; i < job->records; ++i)
+    {
+        if (-1 == tioc_writer_write_unsigned(writer, "timestamp",
+                    1534466554ULL + i) ||
+            -1 == tioc_writer_write_uuid(writer, "id", u) ||
+            -1 == tioc_writer_write_string(writer, "name", "John"))
+        {
+            tioc_writer_close(writer);
+            goto cleanup;
+        }
+    }
+
+    if (-1 == tioc_writer_close(writer)) goto cleanup;
+
+    if (-1 == fseek(file, 0, SEEK_END) || -1 == (size = ftell(file)))
+    {
+        warn("ftell()");
+        goto cleanup;
+    }
+    rewind(file);
+
+    if (!(data = malloc(size)) || (size_t)size != fread(data, 1, size, file))
+    {
+        warn("fread()");
+        goto cleanup;
+    }
+
+    if (!(reader = tioc_reader_open(data, size))) goto cleanup;
+
+    start = now();
+    for (i = 0; i < job->records; ++i)
+    {
+        if (-1 == tioc_reader_read_unsigned(reader, "timestamp", &n) ||
+            -1 == tioc_reader_read_uuid(reader, "id", u) ||
+            -1 == tioc_reader_read_string(reader, "name", &s))
+        {
+            goto cleanup;
+        }
+        free(s);
+    }
+    job->seconds = now() - start;
+
+    rc = 0;
+
+cleanup:
+    tioc_reader_close(reader);
+    free(data);
+    fclose(file);
+    return rc;
+}
+
+static int arena_job(struct job *job)
+{
+    FILE *file;
+    char *data = NULL;
+    size_t size = 0, i;
+    tioc_reader_t *reader = NULL;
+    tioc_arena_t *arena = NULL;
+    unsigned long long n;
+    uuid_t u;
+    char *s;
+    double start;
+    int rc = -1;
+
+    if (!(file = open_memstream(&data, &size)))
+    {
+        warn("open_memstream()");
+        return -1;
+    }
+
+    rc = write_records(file, job->records);
+    if (EOF == fclose(file)) rc = -1;
+    if (-1 == rc) goto cleanup;
+
+    rc = -1;
+    if (!(reader = tioc_reader_open(data, size)) ||
+        !(arena = tioc_arena_create(0)))
+    {
+        goto cleanup;
+    }
+
+    job->allocations = allocations;
+    start = now();
+    for (i = 0; i < job->records; ++i)
+    {
+        if (-1 == tioc_reader_read_unsigned(reader, "timestamp", &n) ||
+            -1 == tioc_reader_read_uuid(reader, "id", u) ||
+            -1 == tioc_reader_read_string_arena(reader, "name", arena, &s))
+        {
+            goto cleanup;
+        }
+
+        if (0 == (i + 1) % ARENA_BATCH) tioc_arena_reset(arena);
+    }
+    job->seconds = now() - start;
+    job->allocations = allocations - job->allocations;
+
+    rc = 0;
+
+cleanup:
+    tioc_arena_destroy(arena);
+    tioc_reader_close(reader);
+    free(data);
+    return rc;
+}
+
+static int small_job(struct job *job)
+{
+    FILE *file;
+    char *data = NULL;
+    size_t size = 0, i;
+    tioc_reader_t *reader = NULL;
+    tioc_string_t s;
+    unsigned long long n;
+    uuid_t u;
+    double start;
+    int rc = -1;
+
+    tioc_string_init(&s);
+
+    if (!(file = open_memstream(&data, &size)))
+    {
+        warn("open_memstream()");
+        return -1;
+    }
+
+    rc = write_records(file, job->records);
+    if (EOF == fclose(file)) rc = -1;
+    if (-1 == rc) goto cleanup;
+
+    rc = -1;
+    if (!(reader = tioc_reader_open(data, size))) goto cleanup;
+
+    job->allocations = allocations;
+    start = now();
+    for (i = 0; i < job->records; ++i)
+    {
+        if (-1 == tioc_reader_read_unsigned(reader, "timestamp", &n) ||
+            -1 == tioc_reader_read_uuid(reader, "id", u) ||
+            -1 == tioc_reader_read_string_small(reader, "name", &s))
+        {
+            goto cleanup;
+        }
+    }
+    job->seconds = now() - start;
+    job->allocations = allocations - job->allocations;
+
+    rc = 0;
+
+cleanup:
+    tioc_string_free(&s);
+    tioc_reader_close(reader);
+    free(data);
+    return rc;
+}
+
+static int parallel_job(struct job *job, unsigned threads)
+{
+    FILE *file;
+    char *data = NULL;
+    size_t size = 0;
+    tioc_reader_t *reader = NULL;
+    struct counts counts = { NULL, 0 };
+    double start;
+    int rc = -1;
+
+    if (!(file = open_memstream(&data, &size)))
+    {
+        warn("open_memstream()");
+        return -1;
+    }
+
+    rc = write_records(file, job->records);
+    if (EOF == fclose(file)) rc = -1;
+    if (-1 == rc) goto cleanup;
+
+    rc = -1;
+    if (!(reader = tioc_reader_open(data, size))) goto cleanup;
+
+    if (!(counts.chunks = calloc(threads * PARALLEL_CHUNKS, sizeof(size_t))))
+    {
+        warnx("calloc() failed.");
+        goto cleanup;
+    }
+
+    start = now();
+    if (-1 == tioc_reader_parse_parallel
+              (
+                  reader,
+                  threads,
+                  threads * PARALLEL_CHUNKS,
+                  parse_chunk,
+                  merge_chunk,
+                  &counts
+              ))
+    {
+        goto cleanup;
+    }
+    job->seconds = now() - start;
+
+    if (counts.total != job->records)
+    {
+        warnx("Parsed %zu records of %zu.", counts.total, job->records);
+        goto cleanup;
+    }
+
+    rc = 0;
+
+cleanup:
+    free(counts.chunks);
+    tioc_reader_close(reader);
+    free(data);
+    return rc;
+}
+
+static int parse_chunk(tioc_reader_t *reader, size_t chunk, void *context)
+{
+    struct counts *counts = context;
+    unsigned long long n;
+    uuid_t u;
+    tioc_view_t v;
+
+    while (!tioc_reader_eof(reader))
+    {
+        if (-1 == tioc_reader_read_unsigned(reader, "timestamp", &n) ||
+            -1 == tioc_reader_read_uuid(reader, "id", u) ||
+            -1 == tioc_reader_read_string_view(reader, "name", &v))
+        {
+            return -1;
+        }
+
+        ++counts->chunks[chunk];
+    }
+
+    return 0;
+}
+
+static int merge_chunk(size_t chunk, void *context)
+{
+    struct counts *counts = context;
+
+    counts->total += counts->chunks[chunk];
+    return 0;
+}
+
+static void discard_error(tioc_error_t error, const char *message, void *c)
+{
+    (void)error;
+    (void)message;
+    (void)c;
+}
+
+static int mismatch_job(struct job *job, int format)
+{
+    FILE *file;
+    char *data = NULL;
+    size_t size = 0, i;
+    tioc_reader_t *reader = NULL;
+    tioc_view_t v;
+    unsigned long long n;
+    uuid_t u;
+    double start;
+    int rc = -1;
+
+    if (!(file = open_memstream(&data, &size)))
+    {
+        warn("open_memstream()");
+        return -1;
+    }
+
+    rc = write_records(file, job->records);
+    if (EOF == fclose(file)) rc = -1;
+    if (-1 == rc) goto cleanup;
+
+    rc = -1;
+    if (!(reader = tioc_reader_open(data, size))) goto cleanup;
+
+    tioc_set_error_handler(format ? discard_error : NULL, NULL);
+
+    start = now();
+    for (i = 0; i < job->records; ++i)
+    {
+        if (-1 != tioc_reader_expect_unsigned(reader, "timestamp", 0) ||
+            TIOC_ERROR_MISMATCH != tioc_last_error() ||
+            -1 == tioc_reader_read_unsigned(reader, "timestamp", &n) ||
+            -1 == tioc_reader_read_uuid(reader, "id", u) ||
+            -1 == tioc_reader_read_string_view(reader, "name", &v))
+        {
+            goto cleanup;
+        }
+    }
+    job->seconds = now() - start;
+
+    rc = 0;
+
+cleanup:
+    tioc_set_error_handler(tioc_print_error, NULL);
+    tioc_reader_close(reader);
+    free(data);
+    return rc;
+}
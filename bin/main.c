@@ -1,19 +1,45 @@
+#define _GNU_SOURCE
 #include <tioc/tioc.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <locale.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <err.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
 
 int help(void);
 
 /*
- * Writes the remaining bytes on stdin to stdout.
+ * Writes the remaining bytes on stdin to stdout with pass_through().
+ *
+ * Commands that chain make stdin unbuffered before reading from it, so that
+ * nothing has been read ahead of the stream.
  */
 void chain(void);
 
+/*
+ * Copies everything from in to out, inside the kernel where possible: with
+ * splice() if either is a pipe, otherwise with sendfile(), and otherwise with
+ * a read()/write() loop.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int pass_through(int in, int out);
+
+/*
+ * Writes size bytes at data to fd, retrying on partial writes and EINTR.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int write_fully(int fd, const char *data, size_t size);
+
 /*
  * Obtains a value from the next argument.
  *
@@ -24,20 +50,110 @@ void chain(void);
  */
 int get_argument(int argc, const char *argv[], int *argi, const char *arg, const char **value, int *type, int dtype);
 
+/*
+ * A field given to the write command.
+ *
+ * type is 1 for unsigned, 2 for UUID, 3 for string and 4 for blob.  n and u
+ * hold the parsed value of unsigned and UUID fields, and fd the open file of a
+ * blob field.
+ */
+struct write_field
+{
+    const char *label;
+    int type;
+    const char *value;
+    unsigned long long n;
+    uuid_t u;
+    int fd;
+};
+
+/*
+ * Called by main().
+ */
+int write_command(int argc, const char *argv[]);
+
+/*
+ * Parses the value of an unsigned or UUID field, or opens the file of a blob
+ * field, so that bad values are reported before anything is written.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int parse_write_field(struct write_field *field);
+
+/*
+ * Called by main().
+ */
+int read_command(int argc, const char *argv[]);
+
+/*
+ * Called by main().
+ */
+int expect_command(int argc, const char *argv[]);
+
+/*
+ * A line of an expect manifest: the field that it expects, and where it is in
+ * the manifest.
+ */
+struct manifest_entry
+{
+    tioc_label_t label;
+    struct write_field field;
+    size_t line;
+};
+
+/*
+ * Called by expect_command() for --manifest.  Verifies the whole of stdin
+ * against the manifest in one pass, stopping at the first mismatch.
+ */
+int expect_manifest(const char *filename);
+
+/*
+ * Parses the manifest in data, which is modified in place and must outlive
+ * the entries.  *entries should be free()'d.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int parse_manifest
+(
+    char *data,
+    size_t size,
+    struct manifest_entry **entries,
+    size_t *count
+);
+
+/*
+ * Reads a blob and checks that it has the same content as the file named.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int expect_blob_file
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    const char *filename
+);
+
 /*
  * Called by main().
  */
-int write(int argc, const char *argv[]);
+int index_command(int argc, const char *argv[]);
 
 /*
  * Called by main().
  */
-int read(int argc, const char *argv[]);
+int transcode_command(int argc, const char *argv[]);
 
 /*
  * Called by main().
  */
-int expect(int argc, const char *argv[]);
+int verify_command(int argc, const char *argv[]);
+
+/*
+ * Reads all of standard input into a buffer allocated with malloc().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int read_stdin(char **data, size_t *size);
 
 int main(int argc, const char *argv[])
 {
@@ -53,15 +169,27 @@ int main(int argc, const char *argv[])
         }
         else if (!strcmp(arg, "write"))
         {
-            return write(argc - argi - 1, argv + argi + 1);
+            return write_command(argc - argi - 1, argv + argi + 1);
         }
         else if (!strcmp(arg, "read"))
         {
-            return read(argc - argi - 1, argv + argi + 1);
+            return read_command(argc - argi - 1, argv + argi + 1);
         }
         else if (!strcmp(arg, "expect"))
         {
-            return expect(argc - argi - 1, argv + argi + 1);
+            return expect_command(argc - argi - 1, argv + argi + 1);
+        }
+        else if (!strcmp(arg, "index"))
+        {
+            return index_command(argc - argi - 1, argv + argi + 1);
+        }
+        else if (!strcmp(arg, "transcode"))
+        {
+            return transcode_command(argc - argi - 1, argv + argi + 1);
+        }
+        else if (!strcmp(arg, "verify"))
+        {
+            return verify_command(argc - argi - 1, argv + argi + 1);
         }
         else
         {
@@ -79,27 +207,25 @@ int help()
     return WEXITSTATUS(system("man 1 tioc"));
 }
 
-int write(int argc, const char *argv[])
+int write_command(int argc, const char *argv[])
 {
     int argi = 0;
     const char *arg = NULL;
-    const char *label = NULL;
-    unsigned long long int n = 0;
-    uuid_t u;
-	char *end = NULL;
     int rc = EXIT_FAILURE;
     int chn = 0;
-    char *blobdata = NULL;
-    size_t blobsize = 0;
+    struct write_field *fields = NULL, *field;
+    size_t count = 0, i;
 
     /*
-     * 1 = unsigned
-     * 2 = UUID
-     * 3 = string
-     * 4 = blob
+     * Every field takes at least two arguments.
      */
-    int type = 0;
-    const char *value = NULL;
+    if (!(fields = calloc(argc / 2 + 1, sizeof(*fields))))
+    {
+        warnx("Unable to allocate fields.");
+        goto cleanup;
+    }
+
+    field = &fields[0];
 
     for (; argi < argc; ++argi)
     {
@@ -113,142 +239,193 @@ int write(int argc, const char *argv[])
                 goto cleanup;
             }
 
-            if (label)
+            if (field->label)
             {
                 warnx("A label has already been supplied.");
                 goto cleanup;
             }
 
             ++argi;
-            label = argv[argi];
+            field->label = argv[argi];
         }
         else if (!strcmp(arg, "-c") || !strcmp(arg, "--chain"))
         {
             chn = 1;
+            continue;
         }
         else if (!strcmp(arg, "-n") || !strcmp(arg, "--unsigned"))
         {
-            if (-1 == get_argument(argc, argv, &argi, arg, &value, &type, 1))
+            if (-1 == get_argument(argc, argv, &argi, arg, &field->value,
+                        &field->type, 1))
+            {
                 goto cleanup;
+            }
         }
         else if (!strcmp(arg, "-u") || !strcmp(arg, "--uuid"))
         {
-            if (-1 == get_argument(argc, argv, &argi, arg, &value, &type, 2))
+            if (-1 == get_argument(argc, argv, &argi, arg, &field->value,
+                        &field->type, 2))
+            {
                 goto cleanup;
+            }
         }
         else if (!strcmp(arg, "-s") || !strcmp(arg, "--string"))
         {
-            if (-1 == get_argument(argc, argv, &argi, arg, &value, &type, 3))
+            if (-1 == get_argument(argc, argv, &argi, arg, &field->value,
+                        &field->type, 3))
+            {
                 goto cleanup;
+            }
         }
         else if (!strcmp(arg, "-b") || !strcmp(arg, "--blob"))
         {
-            if (-1 == get_argument(argc, argv, &argi, arg, &value, &type, 4))
+            if (-1 == get_argument(argc, argv, &argi, arg, &field->value,
+                        &field->type, 4))
+            {
                 goto cleanup;
+            }
         }
         else
         {
             warnx("Unknown argument.");
             goto cleanup;
         }
+
+        /*
+         * A field is complete once it has both a label and a value, and the
+         * next one starts.
+         */
+        if (field->label && field->value)
+        {
+            if (-1 == parse_write_field(field)) goto cleanup;
+            field = &fields[++count];
+        }
     }
 
-    if (!label)
+    if (field->value)
     {
         warnx("No label supplied.");
         goto cleanup;
     }
 
+    if (field->label || !count)
+    {
+        warnx("No value supplied.");
+        goto cleanup;
+    }
+
     if (chn) chain();
 
-    if (1 == type)
+    /*
+     * All of the fields go out through stdout's buffer, which is only flushed
+     * early for blobs.
+     */
+    for (i = 0; i < count; ++i)
     {
-        errno = 0;
-        n = strtoull(value, &end, 10);
+        field = &fields[i];
 
-        if (!*value)
+        if (1 == field->type)
         {
-            warnx("Empty unsigned value.");
-            goto cleanup;
+            if (-1 == write_unsigned(stdout, field->label, field->n))
+            {
+                warnx("Unable to write unsigned value.");
+                goto cleanup;
+            }
         }
-
-        if (value == end)
+        else if (2 == field->type)
         {
-            warnx("Invalid unsigned value.");
-            goto cleanup;
+            if (-1 == write_uuid(stdout, field->label, field->u))
+            {
+                warnx("Unable to write UUID.");
+                goto cleanup;
+            }
         }
-
-        if (n == ULLONG_MAX && ERANGE == errno)
+        else if (3 == field->type)
         {
-            warnx("Unsigned value out of range.");
-            goto cleanup;
+            if (-1 == write_string(stdout, field->label, field->value))
+            {
+                warnx("Unable to write string value.");
+                goto cleanup;
+            }
         }
-
-        if (*end)
+        else if (4 == field->type)
         {
-            warnx("Unterminated unsigned value.");
-            goto cleanup;
+            if (-1 == write_blob_fd(stdout, field->label, field->fd))
+            {
+                warnx("Unable to write blob.");
+                goto cleanup;
+            }
         }
-
-        if (-1 == write_unsigned(stdout, label, n))
+        else
         {
-            warnx("Unable to write unsigned value.");
+            warnx("Invalid type. This is a programming error.");
             goto cleanup;
         }
+    }
 
-        rc = EXIT_SUCCESS;
+    rc = EXIT_SUCCESS;
+
+cleanup:
+    for (i = 0; i < count; ++i)
+    {
+        if (4 == fields[i].type) close(fields[i].fd);
     }
-    else if (2 == type)
+
+    free(fields);
+    return rc;
+}
+
+int parse_write_field(struct write_field *field)
+{
+    char *end = NULL;
+
+    if (1 == field->type)
     {
-        if (-1 == uuid_parse(value, u))
+        errno = 0;
+        field->n = strtoull(field->value, &end, 10);
+
+        if (!*field->value)
         {
-            warnx("Invalid UUID.");
-            goto cleanup;
+            warnx("Empty unsigned value.");
+            return -1;
         }
 
-        if (-1 == write_uuid(stdout, label, u))
+        if (field->value == end)
         {
-            warnx("Unable to write string value.");
-            goto cleanup;
+            warnx("Invalid unsigned value.");
+            return -1;
         }
 
-        rc = EXIT_SUCCESS;
-    }
-    else if (3 == type)
-    {
-        if (-1 == write_string(stdout, label, value))
+        if (field->n == ULLONG_MAX && ERANGE == errno)
         {
-            warnx("Unable to write string value.");
-            goto cleanup;
+            warnx("Unsigned value out of range.");
+            return -1;
         }
 
-        rc = EXIT_SUCCESS;
-    }
-    else if (4 == type)
-    {
-        if (-1 == read_file_content(value, &blobdata, &blobsize))
+        if (*end)
         {
-            warnx("Unable to read blob file '%s'.", value);
-            goto cleanup;
+            warnx("Unterminated unsigned value.");
+            return -1;
         }
-
-        if (-1 == write_blob(stdout, label, blobdata, blobsize))
+    }
+    else if (2 == field->type)
+    {
+        if (-1 == uuid_parse(field->value, field->u))
         {
-            warnx("Unable to write blob.");
-            goto cleanup;
+            warnx("Invalid UUID.");
+            return -1;
         }
-
-        rc = EXIT_SUCCESS;
     }
-    else
+    else if (4 == field->type)
     {
-        warnx("Invalid type. This is a programming error.");
-        goto cleanup;
+        if (-1 == (field->fd = open(field->value, O_RDONLY)))
+        {
+            warnx("Unable to open blob file '%s'.", field->value);
+            return -1;
+        }
     }
 
-cleanup:
-    free(blobdata);
-    return rc;
+    return 0;
 }
 
 int get_argument(int argc, const char *argv[], int *argi, const char *arg, const char **value, int *type, int dtype)
@@ -273,7 +450,7 @@ int get_argument(int argc, const char *argv[], int *argi, const char *arg, const
     return 0;
 }
 
-int read(int argc, const char *argv[])
+int read_command(int argc, const char *argv[])
 {
     int argi = 0;
     const char *arg = NULL;
@@ -284,8 +461,7 @@ int read(int argc, const char *argv[])
     int quiet = 0;
     int chn = 0;
     char *string = NULL;
-    char *blobdata = NULL;
-    size_t blobsize = 0;
+    int fd = -1;
 
     /*
      * 1 = unsigned
@@ -374,6 +550,16 @@ int read(int argc, const char *argv[])
         }
     }
 
+    /*
+     * Nothing may be read ahead of the field if the rest of stdin is to be
+     * chained through to stdout.
+     */
+    if (chn && setvbuf(stdin, NULL, _IONBF, 0))
+    {
+        warnx("Unable to unbuffer standard input.");
+        goto cleanup;
+    }
+
     if (1 == type)
     {
         if (-1 == read_unsigned(stdin, label, &n))
@@ -416,19 +602,22 @@ int read(int argc, const char *argv[])
     }
     else if (4 == type)
     {
-        if (-1 == read_blob(stdin, label, &blobdata, &blobsize))
+        /*
+         * The payload is written straight to the descriptor, so anything
+         * already on stdout has to go first.
+         */
+        fd = quiet ? open("/dev/null", O_WRONLY) : dup(STDOUT_FILENO);
+
+        if (EOF == fflush(stdout) || -1 == fd)
         {
-            warnx("Unable to read blob.");
+            warnx("Unable to write blob.");
             goto cleanup;
         }
 
-        if (!quiet)
+        if (-1 == read_blob_to_fd(stdin, label, fd, NULL))
         {
-            if (1 != fwrite(blobdata, blobsize, 1, stdout))
-            {
-                warnx("Unable to write blob.");
-                goto cleanup;
-            }
+            warnx("Unable to read blob.");
+            goto cleanup;
         }
 
         rc = EXIT_SUCCESS;
@@ -443,12 +632,12 @@ int read(int argc, const char *argv[])
 
 cleanup:
     free(string);
-    free(blobdata);
+    if (-1 != fd) close(fd);
 
     return rc;
 }
 
-int expect(int argc, const char *argv[])
+int expect_command(int argc, const char *argv[])
 {
     int argi = 0;
     const char *arg = NULL;
@@ -463,6 +652,7 @@ int expect(int argc, const char *argv[])
     size_t blobsize_expected = 0;
     char *blobdata_actual = NULL;
     size_t blobsize_actual = 0;
+    const char *manifest = NULL;
 
     /*
      * 1 = unsigned
@@ -504,6 +694,17 @@ int expect(int argc, const char *argv[])
             chn = 1;
             quiet = 1;
         }
+        else if (!strcmp(arg, "-m") || !strcmp(arg, "--manifest"))
+        {
+            if (argi >= argc - 1)
+            {
+                warnx("The '%s' argument requires a value.", arg);
+                goto cleanup;
+            }
+
+            ++argi;
+            manifest = argv[argi];
+        }
         else if (!strcmp(arg, "-n") || !strcmp(arg, "--unsigned"))
         {
             if (-1 == get_argument(argc, argv, &argi, arg, &value, &type, 1))
@@ -531,6 +732,28 @@ int expect(int argc, const char *argv[])
         }
     }
 
+    if (manifest)
+    {
+        if (label || type || chn)
+        {
+            warnx("A manifest cannot be combined with a label, value or chain.");
+            goto cleanup;
+        }
+
+        rc = expect_manifest(manifest);
+        goto cleanup;
+    }
+
+    /*
+     * Nothing may be read ahead of the field if the rest of stdin is to be
+     * chained through to stdout.
+     */
+    if (chn && setvbuf(stdin, NULL, _IONBF, 0))
+    {
+        warnx("Unable to unbuffer standard input.");
+        goto cleanup;
+    }
+
     if (1 == type)
     {
         errno = 0;
@@ -657,16 +880,678 @@ cleanup:
     return rc;
 }
 
-void chain(void)
+int expect_manifest(const char *filename)
 {
-    int c;
+    char *text = NULL, *data = NULL;
+    size_t text_size = 0, size = 0, count = 0, i, offset;
+    struct manifest_entry *entries = NULL, *entry;
+    struct write_field *field;
+    tioc_reader_t *reader = NULL;
+    struct stat st;
+    int result = 0;
+    int rc = EXIT_FAILURE;
+
+    if (-1 == read_file_content(filename, &text, &text_size) ||
+        -1 == parse_manifest(text, text_size, &entries, &count))
+    {
+        warnx("Unable to read manifest '%s'.", filename);
+        goto cleanup;
+    }
+
+    /*
+     * Input from a file is mapped rather than copied, unless something has
+     * already read part of it: the mapping would start at the beginning of the
+     * file rather than at stdin's position, whose data (and encoding) is what
+     * a pipe would have delivered.
+     */
+    if (0 == fstat(STDIN_FILENO, &st) && S_ISREG(st.st_mode) &&
+        0 == lseek(STDIN_FILENO, 0, SEEK_CUR))
+    {
+        reader = tioc_reader_map("/dev/stdin");
+    }
+    else if (0 == read_stdin(&data, &size))
+    {
+        reader = tioc_reader_open(data, size);
+    }
+
+    if (!reader)
+    {
+        warnx("Unable to read standard input.");
+        goto cleanup;
+    }
 
-    while (EOF != (c = getchar()))
+    for (i = 0; i < count; ++i)
     {
-        if (EOF == putchar(c))
+        entry = &entries[i];
+        field = &entry->field;
+        offset = tioc_reader_tell(reader);
+
+        if (1 == field->type)
+        {
+            result = tioc_reader_expect_unsigned_l(reader, &entry->label,
+                    field->n);
+        }
+        else if (2 == field->type)
+        {
+            result = tioc_reader_expect_uuid_l(reader, &entry->label,
+                    field->u);
+        }
+        else if (3 == field->type)
+        {
+            result = tioc_reader_expect_string_l(reader, &entry->label,
+                    field->value);
+        }
+        else
+        {
+            result = expect_blob_file(reader, &entry->label, field->value);
+        }
+
+        if (-1 == result)
         {
-            warnx("Unable to write byte to standard output.");
-            return;
+            warnx
+            (
+                "Mismatch in record %zu (manifest line %zu) at offset %zu.",
+                i + 1,
+                entry->line,
+                offset
+            );
+            goto cleanup;
         }
     }
+
+    if (!tioc_reader_eof(reader))
+    {
+        warnx
+        (
+            "Unexpected data after record %zu at offset %zu.",
+            count,
+            tioc_reader_tell(reader)
+        );
+        goto cleanup;
+    }
+
+    rc = EXIT_SUCCESS;
+
+cleanup:
+    tioc_reader_close(reader);
+    free(data);
+    free(entries);
+    free(text);
+
+    return rc;
+}
+
+int parse_manifest
+(
+    char *data,
+    size_t size,
+    struct manifest_entry **entries,
+    size_t *count
+)
+{
+    static const char *types[] = {"unsigned", "uuid", "string", "blob"};
+    struct manifest_entry *entry, *bigger;
+    size_t capacity = 0, line = 0, t;
+    char *p = data, *end = data + size, *eol, *label, *type;
+
+    *entries = NULL;
+    *count = 0;
+
+    for (; p < end; p = eol + 1)
+    {
+        ++line;
+
+        if (!(eol = memchr(p, '\n', end - p))) eol = end;
+        *eol = 0;
+
+        if (p == eol || '#' == *p) continue;
+
+        /*
+         * "<label> <type> <value>", where the value is the rest of the line.
+         */
+        label = p;
+        if (!(type = strchr(label, ' ')) || !(p = strchr(++type, ' ')))
+        {
+            warnx("Manifest line %zu: Expected a label, type and value.", line);
+            goto error;
+        }
+        type[-1] = 0;
+        *p++ = 0;
+
+        if (*count == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 64;
+            if (!(bigger = realloc(*entries, capacity * sizeof(**entries))))
+            {
+                warnx("Unable to allocate manifest entries.");
+                goto error;
+            }
+            *entries = bigger;
+        }
+
+        entry = &(*entries)[*count];
+        memset(entry, 0, sizeof(*entry));
+        entry->line = line;
+        entry->field.label = label;
+        entry->field.value = p;
+
+        t = 0;
+        while (t < 4 && strcmp(type, types[t])) ++t;
+
+        if (4 == t)
+        {
+            warnx("Manifest line %zu: Invalid type '%s'.", line, type);
+            goto error;
+        }
+
+        entry->field.type = (int)t + 1;
+
+        if (-1 == tioc_label_init(&entry->label, label) ||
+            (4 != entry->field.type &&
+             -1 == parse_write_field(&entry->field)))
+        {
+            warnx("Manifest line %zu: Invalid field.", line);
+            goto error;
+        }
+
+        ++*count;
+    }
+
+    return 0;
+
+error:
+    free(*entries);
+    *entries = NULL;
+    *count = 0;
+    return -1;
+}
+
+int expect_blob_file
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    const char *filename
+)
+{
+    char buffer[64 * 1024];
+    tioc_view_t view;
+    struct stat st;
+    size_t done = 0;
+    ssize_t n;
+    int fd = -1;
+    int rc = -1;
+
+    if (-1 == tioc_reader_read_blob_view_l(reader, label, &view)) goto cleanup;
+
+    if (-1 == (fd = open(filename, O_RDONLY)) || -1 == fstat(fd, &st))
+    {
+        warnx("Unable to open blob file '%s'.", filename);
+        goto cleanup;
+    }
+
+    if ((unsigned long long)st.st_size != view.size)
+    {
+        warnx
+        (
+            "Expected a blob size of %llu but found %zu.",
+            (unsigned long long)st.st_size,
+            view.size
+        );
+        goto cleanup;
+    }
+
+    /*
+     * The file is compared a piece at a time, so that large blobs are never
+     * held in memory twice.
+     */
+    while (done < view.size)
+    {
+        if (-1 == (n = read(fd, buffer, sizeof(buffer))) || !n)
+        {
+            if (-1 == n && EINTR == errno) continue;
+            warnx("Unable to read blob file '%s'.", filename);
+            goto cleanup;
+        }
+
+        if ((size_t)n > view.size - done ||
+            memcmp(buffer, view.data + done, n))
+        {
+            warnx("Blob content mismatch.");
+            goto cleanup;
+        }
+
+        done += n;
+    }
+
+    rc = 0;
+
+cleanup:
+    if (-1 != fd) close(fd);
+    return rc;
+}
+
+int index_command(int argc, const char *argv[])
+{
+    int argi = 0;
+    const char *arg = NULL;
+    const char *filename = NULL;
+    const char *output = NULL;
+    const char *value = NULL;
+    char *end = NULL;
+    char *generated = NULL;
+    unsigned long long n = 0;
+    tioc_index_t *index = NULL;
+    int rc = EXIT_FAILURE;
+
+    for (; argi < argc; ++argi)
+    {
+        arg = argv[argi];
+
+        if (!strcmp(arg, "-n") || !strcmp(arg, "--block-records"))
+        {
+            if (argi >= argc - 1)
+            {
+                warnx("The '%s' argument requires a value.", arg);
+                goto cleanup;
+            }
+
+            ++argi;
+            value = argv[argi];
+        }
+        else if (!strcmp(arg, "-o") || !strcmp(arg, "--output"))
+        {
+            if (argi >= argc - 1)
+            {
+                warnx("The '%s' argument requires a value.", arg);
+                goto cleanup;
+            }
+
+            ++argi;
+            output = argv[argi];
+        }
+        else if (!filename)
+        {
+            filename = arg;
+        }
+        else
+        {
+            warnx("Unknown argument.");
+            goto cleanup;
+        }
+    }
+
+    if (!filename)
+    {
+        warnx("A file name is required.");
+        goto cleanup;
+    }
+
+    if (value)
+    {
+        errno = 0;
+        n = strtoull(value, &end, 10);
+
+        if (!*value || value == end || *end || !n ||
+            (n == ULLONG_MAX && ERANGE == errno) || n > SIZE_MAX)
+        {
+            warnx("Invalid number of records per block.");
+            goto cleanup;
+        }
+    }
+
+    if (!output)
+    {
+        if (!(generated = malloc(strlen(filename) + sizeof(".idx"))))
+        {
+            warnx("Unable to allocate memory.");
+            goto cleanup;
+        }
+
+        strcpy(generated, filename);
+        strcat(generated, ".idx");
+        output = generated;
+    }
+
+    if (!(index = tioc_index_build(filename, (size_t)n)))
+    {
+        warnx("Unable to index '%s'.", filename);
+        goto cleanup;
+    }
+
+    if (-1 == tioc_index_save(index, output))
+    {
+        warnx("Unable to write index '%s'.", output);
+        goto cleanup;
+    }
+
+    rc = EXIT_SUCCESS;
+
+cleanup:
+    tioc_index_free(index);
+    free(generated);
+
+    return rc;
+}
+
+int transcode_command(int argc, const char *argv[])
+{
+    int argi = 0;
+    const char *arg = NULL;
+    const char *filename = NULL;
+    char *data = NULL;
+    size_t size = 0;
+    tioc_reader_t *reader = NULL;
+    tioc_writer_t *writer = NULL;
+    tioc_encoding_t encoding;
+    int to = -1;
+    int rc = EXIT_FAILURE;
+
+    for (; argi < argc; ++argi)
+    {
+        arg = argv[argi];
+
+        if (!strcmp(arg, "-t") || !strcmp(arg, "--to"))
+        {
+            if (argi >= argc - 1)
+            {
+                warnx("The '%s' argument requires a value.", arg);
+                goto cleanup;
+            }
+
+            ++argi;
+
+            if (!strcmp(argv[argi], "text"))
+            {
+                to = TIOC_ENCODING_TEXT;
+            }
+            else if (!strcmp(argv[argi], "binary"))
+            {
+                to = TIOC_ENCODING_BINARY;
+            }
+            else if (!strcmp(argv[argi], "checked"))
+            {
+                to = TIOC_ENCODING_CHECKED;
+            }
+            else
+            {
+                warnx("Invalid encoding '%s'.", argv[argi]);
+                goto cleanup;
+            }
+        }
+        else if (!filename)
+        {
+            filename = arg;
+        }
+        else
+        {
+            warnx("Unknown argument.");
+            goto cleanup;
+        }
+    }
+
+    if (filename)
+    {
+        if (!(reader = tioc_reader_map(filename))) goto cleanup;
+    }
+    else
+    {
+        if (-1 == read_stdin(&data, &size))
+        {
+            warnx("Unable to read standard input.");
+            goto cleanup;
+        }
+
+        if (!(reader = tioc_reader_open(data, size))) goto cleanup;
+    }
+
+    /*
+     * By default, convert to whichever encoding the input is not in.
+     */
+    encoding = tioc_reader_encoding(reader);
+    if (-1 == to)
+    {
+        to = TIOC_ENCODING_TEXT == encoding ? TIOC_ENCODING_BINARY
+                                            : TIOC_ENCODING_TEXT;
+    }
+
+    if (-1 == fflush(stdout) ||
+        !(writer = tioc_writer_open_encoding(dup(STDOUT_FILENO), 0, to)))
+    {
+        warnx("Unable to write to standard output.");
+        goto cleanup;
+    }
+
+    if (-1 == tioc_transcode(reader, writer))
+    {
+        warnx("Unable to transcode.");
+        goto cleanup;
+    }
+
+    rc = EXIT_SUCCESS;
+
+cleanup:
+    if (writer && -1 == tioc_writer_close(writer)) rc = EXIT_FAILURE;
+    tioc_reader_close(reader);
+    free(data);
+
+    return rc;
+}
+
+int verify_command(int argc, const char *argv[])
+{
+    int argi = 0;
+    const char *arg = NULL;
+    const char *filename = NULL;
+    const char *value = NULL;
+    char *end = NULL;
+    char *data = NULL;
+    size_t size = 0;
+    size_t offset = 0;
+    unsigned long long threads = 0;
+    tioc_reader_t *reader = NULL;
+    struct timespec start, finish;
+    double seconds;
+    int rc = EXIT_FAILURE;
+
+    for (; argi < argc; ++argi)
+    {
+        arg = argv[argi];
+
+        if (!strcmp(arg, "-j") || !strcmp(arg, "--threads"))
+        {
+            if (argi >= argc - 1)
+            {
+                warnx("The '%s' argument requires a value.", arg);
+                goto cleanup;
+            }
+
+            ++argi;
+            value = argv[argi];
+        }
+        else if (!filename)
+        {
+            filename = arg;
+        }
+        else
+        {
+            warnx("Unknown argument.");
+            goto cleanup;
+        }
+    }
+
+    if (value)
+    {
+        errno = 0;
+        threads = strtoull(value, &end, 10);
+
+        if (!*value || value == end || *end || !threads ||
+            (threads == ULLONG_MAX && ERANGE == errno) || threads > SIZE_MAX)
+        {
+            warnx("Invalid number of threads.");
+            goto cleanup;
+        }
+    }
+
+    if (filename)
+    {
+        if (!(reader = tioc_reader_map(filename))) goto cleanup;
+    }
+    else
+    {
+        if (-1 == read_stdin(&data, &size))
+        {
+            warnx("Unable to read standard input.");
+            goto cleanup;
+        }
+
+        if (!(reader = tioc_reader_open(data, size))) goto cleanup;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (-1 == tioc_reader_verify(reader, (size_t)threads, &offset))
+    {
+        if (SIZE_MAX != offset)
+        {
+            warnx("Malformed data at offset %zu.", offset);
+        }
+        else
+        {
+            warnx("Unable to verify.");
+        }
+
+        goto cleanup;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+
+    size = tioc_reader_tell(reader);
+
+    seconds = (double)(finish.tv_sec - start.tv_sec) +
+              (double)(finish.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf
+    (
+        "Verified %zu bytes in %.3f s (%.1f MB/s).\n",
+        size,
+        seconds,
+        seconds > 0 ? (double)size / seconds / 1e6 : 0
+    );
+
+    rc = EXIT_SUCCESS;
+
+cleanup:
+    tioc_reader_close(reader);
+    free(data);
+
+    return rc;
+}
+
+int read_stdin(char **data, size_t *size)
+{
+    char *buffer = NULL, *bigger;
+    size_t capacity = 0, used = 0, n;
+
+    do
+    {
+        if (used == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 64 * 1024;
+            if (!(bigger = realloc(buffer, capacity)))
+            {
+                free(buffer);
+                return -1;
+            }
+            buffer = bigger;
+        }
+
+        n = fread(buffer + used, 1, capacity - used, stdin);
+        used += n;
+    }
+    while (n);
+
+    if (ferror(stdin))
+    {
+        free(buffer);
+        return -1;
+    }
+
+    *data = buffer;
+    *size = used;
+    return 0;
+}
+
+void chain(void)
+{
+    if (EOF == fflush(stdout))
+    {
+        warnx("Unable to flush standard output.");
+        return;
+    }
+
+    if (-1 == pass_through(STDIN_FILENO, STDOUT_FILENO))
+    {
+        warnx("Unable to copy standard input to standard output.");
+    }
+}
+
+int pass_through(int in, int out)
+{
+    /*
+     * 0 = splice
+     * 1 = sendfile
+     * 2 = read/write
+     */
+    int method = 0;
+    static char buffer[256 * 1024];
+    ssize_t n = 0;
+
+    for (;;)
+    {
+        if (0 == method)
+        {
+            n = splice(in, NULL, out, NULL, sizeof(buffer), SPLICE_F_MOVE);
+        }
+        else if (1 == method)
+        {
+            n = sendfile(out, in, NULL, sizeof(buffer));
+        }
+        else if (-1 != (n = read(in, buffer, sizeof(buffer))) && n)
+        {
+            if (-1 == write_fully(out, buffer, n)) return -1;
+        }
+
+        if (!n) return 0;
+
+        if (-1 == n)
+        {
+            if (EINTR == errno) continue;
+            if (method < 2 && (EINVAL == errno || ENOSYS == errno))
+            {
+                ++method;
+                continue;
+            }
+
+            return -1;
+        }
+    }
+}
+
+int write_fully(int fd, const char *data, size_t size)
+{
+    ssize_t n;
+
+    while (size)
+    {
+        if (-1 == (n = write(fd, data, size)))
+        {
+            if (EINTR == errno) continue;
+            return -1;
+        }
+
+        data += n;
+        size -= n;
+    }
+
+    return 0;
 }
@@ -0,0 +1,237 @@
+#include "tioc.h"
+#include "internal.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+/*******************************************************************************
+ * OVERVIEW
+ *
+ * A bump allocator over a list of chunks.
+ *
+ * Allocations are carved from the current chunk until it is full, and then
+ * from the next one, which is allocated if necessary.  Resetting rewinds to the
+ * first chunk without freeing any, so a batch-at-a-time consumer reaches a
+ * steady state in which it allocates nothing.  Allocations too large for a
+ * chunk get a chunk of their own, which is freed on reset.
+ ******************************************************************************/
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/*
+ * The default size of a chunk.
+ */
+#define ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+
+/*
+ * The alignment of every allocation: that of the most demanding basic type.
+ */
+#define ARENA_ALIGNMENT __alignof__(union arena_align)
+
+/*******************************************************************************
+ * TYPES
+ ******************************************************************************/
+
+union arena_align
+{
+    long double d;
+    long long n;
+    void *p;
+};
+
+struct arena_chunk
+{
+    struct arena_chunk *next;
+    size_t size;
+    size_t used;
+    union arena_align data[];
+};
+
+struct tioc_arena
+{
+    size_t chunk_size;
+
+    /*
+     * The chunks of chunk_size bytes, the one being allocated from, and the
+     * last one.
+     */
+    struct arena_chunk *chunks;
+    struct arena_chunk *current;
+    struct arena_chunk *tail;
+
+    /*
+     * Chunks holding a single allocation larger than chunk_size.
+     */
+    struct arena_chunk *large;
+};
+
+/*******************************************************************************
+ * ARENA FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Allocates a chunk with room for size bytes.
+ *
+ * Returns NULL on failure.
+ */
+static struct arena_chunk *new_chunk(size_t size);
+
+/*
+ * Frees a list of chunks.
+ */
+static void free_chunks(struct arena_chunk *chunk);
+
+/*******************************************************************************
+ * ARENA FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+tioc_arena_t *tioc_arena_create(size_t chunk_size)
+{
+    tioc_arena_t *arena;
+
+    if (!chunk_size) chunk_size = ARENA_DEFAULT_CHUNK_SIZE;
+
+    if (!(arena = malloc(sizeof(*arena))))
+    {
+        tioc_e(TIOC_ERROR_MEMORY, "tioc_arena_create(): malloc() failed.");
+        return NULL;
+    }
+
+    arena->chunk_size = chunk_size;
+    arena->chunks = NULL;
+    arena->current = NULL;
+    arena->tail = NULL;
+    arena->large = NULL;
+
+    return arena;
+}
+
+void *tioc_arena_alloc(tioc_arena_t *arena, size_t size)
+{
+    struct arena_chunk *chunk;
+    char *p;
+
+    if (!arena)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_arena_alloc(): Invalid 'arena' argument."
+        );
+        return NULL;
+    }
+
+    if (size > SIZE_MAX - ARENA_ALIGNMENT)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_MEMORY,
+            "tioc_arena_alloc(): Size %zu is too large.",
+            size
+        );
+        return NULL;
+    }
+
+    size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+    if (size > arena->chunk_size)
+    {
+        if (!(chunk = new_chunk(size))) return NULL;
+
+        chunk->next = arena->large;
+        arena->large = chunk;
+
+        return chunk->data;
+    }
+
+    /*
+     * Move on to the next chunk (one kept by a reset, or a new one) when this
+     * one is full.
+     */
+    chunk = arena->current;
+    while (!chunk || chunk->size - chunk->used < size)
+    {
+        if (chunk && chunk->next)
+        {
+            chunk = chunk->next;
+            continue;
+        }
+
+        if (!(chunk = new_chunk(arena->chunk_size))) return NULL;
+
+        if (arena->tail) arena->tail->next = chunk;
+        else arena->chunks = chunk;
+
+        arena->tail = chunk;
+    }
+
+    arena->current = chunk;
+
+    p = (char*)chunk->data + chunk->used;
+    chunk->used += size;
+
+    return p;
+}
+
+void tioc_arena_reset(tioc_arena_t *arena)
+{
+    struct arena_chunk *chunk;
+
+    if (!arena) return;
+
+    for (chunk = arena->chunks; chunk; chunk = chunk->next) chunk->used = 0;
+    arena->current = arena->chunks;
+
+    free_chunks(arena->large);
+    arena->large = NULL;
+}
+
+void tioc_arena_destroy(tioc_arena_t *arena)
+{
+    if (!arena) return;
+
+    free_chunks(arena->chunks);
+    free_chunks(arena->large);
+    free(arena);
+}
+
+void *tioc_allocate(tioc_arena_t *arena, size_t size)
+{
+    if (arena) return tioc_arena_alloc(arena, size);
+
+    return malloc(size);
+}
+
+void tioc_release(tioc_arena_t *arena, void *p)
+{
+    if (!arena) free(p);
+}
+
+static struct arena_chunk *new_chunk(size_t size)
+{
+    struct arena_chunk *chunk;
+
+    if (!(chunk = malloc(sizeof(*chunk) + size)))
+    {
+        tioc_e(TIOC_ERROR_MEMORY, "tioc_arena_alloc(): malloc() failed.");
+        return NULL;
+    }
+
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+
+    return chunk;
+}
+
+static void free_chunks(struct arena_chunk *chunk)
+{
+    struct arena_chunk *next;
+
+    for (; chunk; chunk = next)
+    {
+        next = chunk->next;
+        free(chunk);
+    }
+}
@@ -0,0 +1,589 @@
+#define _GNU_SOURCE
+#include "tioc.h"
+#include "internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/*******************************************************************************
+ * OVERVIEW
+ *
+ * Writes a writer's buffers asynchronously with io_uring, through the raw
+ * system calls rather than liburing.
+ *
+ * The writer fills one of a fixed set of buffers while the others are being
+ * written.  A full buffer is submitted and the writer moves on to the next,
+ * waiting for its write to complete if it is still in flight, so memory is
+ * bounded by the buffers allocated at the start.  The buffers are registered
+ * with the ring where the kernel allows it, so that it does not have to map
+ * them for every write.
+ *
+ * Writes to a file are made at explicit offsets, so several can be in flight
+ * at once and complete in any order.  A descriptor without offsets (e.g. a
+ * pipe), or in append mode, has only one write in flight at a time, as
+ * nothing else keeps its writes in order.  In both cases, short writes are
+ * resubmitted from where they stopped.
+ *
+ * Where io_uring is not available, each buffer is written with write(2) as
+ * soon as it is submitted.
+ ******************************************************************************/
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/*
+ * The alignment of the buffers.  Page alignment keeps them usable with
+ * O_DIRECT descriptors.
+ */
+#define ASYNC_ALIGNMENT 4096
+
+/*******************************************************************************
+ * TYPES
+ ******************************************************************************/
+
+struct async_buffer
+{
+    char *data;
+
+    /*
+     * While the buffer is in flight: the number of bytes to write, the number
+     * written so far, and the offset of its first byte.
+     */
+    int busy;
+    size_t length;
+    size_t done;
+    off_t offset;
+};
+
+struct tioc_async
+{
+    int fd;
+
+    struct async_buffer *buffers;
+    size_t count;
+    size_t size;
+    char *memory;
+
+    /*
+     * The buffer being filled, the number in flight, and the most that may
+     * be.
+     */
+    size_t current;
+    size_t in_flight;
+    size_t max_in_flight;
+
+    /*
+     * Set if writes are made at explicit offsets, in which case offset is
+     * where the next buffer goes.
+     */
+    int seekable;
+    off_t offset;
+
+    /*
+     * The errno of the first write that failed, or 0.
+     */
+    int error;
+
+    tioc_write_completion_t completion;
+    void *context;
+
+    /*
+     * The ring, or -1 if io_uring is not available, and whether the buffers
+     * are registered with it.
+     */
+    int ring;
+    int registered;
+
+    void *sq_ring;
+    size_t sq_ring_size;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    void *cq_ring;
+    size_t cq_ring_size;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+};
+
+/*******************************************************************************
+ * ASYNC FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Creates the ring and maps its queues, and registers the buffers with it if
+ * the kernel allows.
+ *
+ * Returns -1 if io_uring is not available, 0 on success.
+ */
+static int setup_ring(struct tioc_async *async);
+
+/*
+ * Unmaps and closes the ring.
+ */
+static void close_ring(struct tioc_async *async);
+
+/*
+ * Queues a write of the unwritten part of buffer i, and submits it.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int queue_write(struct tioc_async *async, size_t i);
+
+/*
+ * Handles the completions that are ready, first waiting for at least one if
+ * wait is set.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int reap(struct tioc_async *async, int wait);
+
+/*
+ * Records that a write of buffer i has finished, with error (or 0), and calls
+ * the completion function.
+ */
+static void complete(struct tioc_async *async, size_t i, int error);
+
+/*******************************************************************************
+ * ASYNC FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+struct tioc_async *tioc_async_create
+(
+    int fd,
+    size_t size,
+    size_t count,
+    tioc_write_completion_t completion,
+    void *context
+)
+{
+    struct tioc_async *async;
+    void *memory = NULL;
+    size_t i;
+    int flags;
+
+    if (count < 2) count = 2;
+    size = (size + ASYNC_ALIGNMENT - 1) & ~(size_t)(ASYNC_ALIGNMENT - 1);
+
+    if (!(async = calloc(1, sizeof(*async))))
+    {
+        tioc_e(TIOC_ERROR_MEMORY, "tioc_async_create(): calloc() failed.");
+        return NULL;
+    }
+
+    if (!(async->buffers = calloc(count, sizeof(*async->buffers))) ||
+        posix_memalign(&memory, ASYNC_ALIGNMENT, count * size))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_MEMORY,
+            "tioc_async_create(): Unable to allocate %zu buffers.",
+            count
+        );
+        free(async->buffers);
+        free(async);
+        return NULL;
+    }
+
+    async->fd = fd;
+    async->count = count;
+    async->size = size;
+    async->memory = memory;
+    async->completion = completion;
+    async->context = context;
+    async->ring = -1;
+
+    for (i = 0; i < count; ++i)
+    {
+        async->buffers[i].data = async->memory + i * size;
+    }
+
+    /*
+     * Without offsets (or with O_APPEND, which ignores them), writes can only
+     * be kept in order by having one at a time.
+     */
+    async->offset = lseek(fd, 0, SEEK_CUR);
+    flags = fcntl(fd, F_GETFL);
+
+    async->seekable = -1 != async->offset && -1 != flags && !(flags & O_APPEND);
+    async->max_in_flight = async->seekable ? count - 1 : 1;
+
+    setup_ring(async);
+
+    return async;
+}
+
+char *tioc_async_buffer(struct tioc_async *async)
+{
+    return async->buffers[async->current].data;
+}
+
+size_t tioc_async_size(const struct tioc_async *async)
+{
+    return async->size;
+}
+
+int tioc_async_submit(struct tioc_async *async, size_t used, char **buffer)
+{
+    struct async_buffer *b = &async->buffers[async->current];
+
+    if (async->error)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "tioc_async_submit(): An earlier write failed: %s.",
+            strerror(async->error)
+        );
+        return -1;
+    }
+
+    if (!used)
+    {
+        *buffer = b->data;
+        return 0;
+    }
+
+    b->length = used;
+    b->done = 0;
+
+    /*
+     * Without a ring, the buffer is written straight away, and can be filled
+     * again.
+     */
+    if (-1 == async->ring)
+    {
+        if (-1 == tioc_write_data(async->fd, b->data, used))
+        {
+            complete(async, async->current, errno);
+            tioc_e(TIOC_ERROR_IO, "tioc_async_submit(): write() failed.");
+            return -1;
+        }
+
+        b->done = used;
+        complete(async, async->current, 0);
+        *buffer = b->data;
+        return 0;
+    }
+
+    while (async->in_flight >= async->max_in_flight)
+    {
+        if (-1 == reap(async, 1)) return -1;
+    }
+
+    b->busy = 1;
+    b->offset = async->seekable ? async->offset : -1;
+    if (async->seekable) async->offset += used;
+
+    ++async->in_flight;
+    if (-1 == queue_write(async, async->current)) return -1;
+
+    /*
+     * Move on to the next buffer, which is the oldest to have been submitted.
+     */
+    async->current = (async->current + 1) % async->count;
+    b = &async->buffers[async->current];
+
+    while (b->busy)
+    {
+        if (-1 == reap(async, 1)) return -1;
+    }
+
+    *buffer = b->data;
+    return 0;
+}
+
+int tioc_async_drain(struct tioc_async *async)
+{
+    while (async->in_flight)
+    {
+        if (-1 == reap(async, 1)) return -1;
+    }
+
+    if (async->error)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "tioc_async_drain(): A write failed: %s.",
+            strerror(async->error)
+        );
+        return -1;
+    }
+
+    /*
+     * Writes at explicit offsets do not move the descriptor's position, so
+     * move it past them for anything that writes to it directly.
+     */
+    if (-1 != async->ring && async->seekable &&
+        -1 == lseek(async->fd, async->offset, SEEK_SET))
+    {
+        tioc_e(TIOC_ERROR_IO, "tioc_async_drain(): lseek() failed.");
+        return -1;
+    }
+
+    return 0;
+}
+
+void tioc_async_resume(struct tioc_async *async)
+{
+    if (async->seekable) async->offset = lseek(async->fd, 0, SEEK_CUR);
+}
+
+int tioc_async_destroy(struct tioc_async *async)
+{
+    int rc;
+
+    if (!async) return 0;
+
+    rc = tioc_async_drain(async);
+
+    close_ring(async);
+    free(async->memory);
+    free(async->buffers);
+    free(async);
+
+    return rc;
+}
+
+static int setup_ring(struct tioc_async *async)
+{
+    struct io_uring_params params;
+    struct iovec *iov;
+    unsigned char *sq, *cq;
+    size_t i;
+    long ring;
+
+    memset(&params, 0, sizeof(params));
+
+    if (-1 == (ring = syscall(__NR_io_uring_setup, async->count, &params)))
+    {
+        return -1;
+    }
+
+    async->ring = (int)ring;
+
+    async->sq_ring_size = params.sq_off.array +
+                          params.sq_entries * sizeof(unsigned);
+    async->cq_ring_size = params.cq_off.cqes +
+                          params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (async->cq_ring_size > async->sq_ring_size)
+        {
+            async->sq_ring_size = async->cq_ring_size;
+        }
+
+        async->cq_ring_size = 0;
+    }
+
+    async->sq_ring = mmap(NULL, async->sq_ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, async->ring, IORING_OFF_SQ_RING);
+
+    if (MAP_FAILED == async->sq_ring)
+    {
+        async->sq_ring = NULL;
+        close_ring(async);
+        return -1;
+    }
+
+    if (async->cq_ring_size)
+    {
+        async->cq_ring = mmap(NULL, async->cq_ring_size,
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                async->ring, IORING_OFF_CQ_RING);
+
+        if (MAP_FAILED == async->cq_ring)
+        {
+            async->cq_ring = NULL;
+            close_ring(async);
+            return -1;
+        }
+    }
+
+    async->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    async->sqes = mmap(NULL, async->sqes_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, async->ring, IORING_OFF_SQES);
+
+    if (MAP_FAILED == async->sqes)
+    {
+        async->sqes = NULL;
+        close_ring(async);
+        return -1;
+    }
+
+    sq = async->sq_ring;
+    cq = async->cq_ring_size ? async->cq_ring : async->sq_ring;
+
+    async->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    async->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    async->sq_array = (unsigned*)(sq + params.sq_off.array);
+
+    async->cq_head = (unsigned*)(cq + params.cq_off.head);
+    async->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    async->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    async->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    /*
+     * Registration pins the buffers, which RLIMIT_MEMLOCK may not allow, in
+     * which case they are passed with each write instead.
+     */
+    if ((iov = malloc(async->count * sizeof(*iov))))
+    {
+        for (i = 0; i < async->count; ++i)
+        {
+            iov[i].iov_base = async->buffers[i].data;
+            iov[i].iov_len = async->size;
+        }
+
+        async->registered = !syscall(__NR_io_uring_register, async->ring,
+                IORING_REGISTER_BUFFERS, iov, (unsigned)async->count);
+
+        free(iov);
+    }
+
+    return 0;
+}
+
+static void close_ring(struct tioc_async *async)
+{
+    if (-1 == async->ring) return;
+
+    if (async->sqes) munmap(async->sqes, async->sqes_size);
+    if (async->cq_ring) munmap(async->cq_ring, async->cq_ring_size);
+    if (async->sq_ring) munmap(async->sq_ring, async->sq_ring_size);
+
+    close(async->ring);
+    async->ring = -1;
+}
+
+static int queue_write(struct tioc_async *async, size_t i)
+{
+    struct async_buffer *b = &async->buffers[i];
+    struct io_uring_sqe *sqe;
+    unsigned tail, index;
+    long n;
+
+    tail = *async->sq_tail;
+    index = tail & *async->sq_mask;
+    sqe = &async->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = async->registered ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = async->fd;
+    sqe->addr = (unsigned long)(b->data + b->done);
+    sqe->len = (unsigned)(b->length - b->done);
+    sqe->off = -1 == b->offset ? (unsigned long long)-1
+                               : (unsigned long long)(b->offset + b->done);
+    sqe->buf_index = async->registered ? (unsigned short)i : 0;
+    sqe->user_data = i;
+
+    async->sq_array[index] = index;
+    __atomic_store_n(async->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    do
+    {
+        n = syscall(__NR_io_uring_enter, async->ring, 1, 0, 0, NULL, 0);
+    }
+    while (-1 == n && (EINTR == errno || EAGAIN == errno));
+
+    if (-1 == n)
+    {
+        complete(async, i, errno);
+        tioc_e(TIOC_ERROR_IO, "tioc_async_submit(): io_uring_enter() failed.");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int reap(struct tioc_async *async, int wait)
+{
+    struct io_uring_cqe *cqe;
+    struct async_buffer *b;
+    unsigned head, tail;
+    size_t i;
+    long n;
+    int res;
+
+    if (wait)
+    {
+        do
+        {
+            n = syscall(__NR_io_uring_enter, async->ring, 0, 1,
+                    IORING_ENTER_GETEVENTS, NULL, 0);
+        }
+        while (-1 == n && EINTR == errno);
+
+        if (-1 == n)
+        {
+            tioc_e(TIOC_ERROR_IO, "reap(): io_uring_enter() failed.");
+            return -1;
+        }
+    }
+
+    head = *async->cq_head;
+    tail = __atomic_load_n(async->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head)
+    {
+        cqe = &async->cqes[head & *async->cq_mask];
+        i = (size_t)cqe->user_data;
+        res = cqe->res;
+        b = &async->buffers[i];
+
+        __atomic_store_n(async->cq_head, head + 1, __ATOMIC_RELEASE);
+
+        if (-EINTR == res || -EAGAIN == res)
+        {
+            if (-1 == queue_write(async, i)) return -1;
+            continue;
+        }
+
+        if (res <= 0)
+        {
+            complete(async, i, res ? -res : EIO);
+            continue;
+        }
+
+        b->done += (size_t)res;
+
+        if (b->done < b->length)
+        {
+            if (-1 == queue_write(async, i)) return -1;
+            continue;
+        }
+
+        complete(async, i, 0);
+    }
+
+    return 0;
+}
+
+static void complete(struct tioc_async *async, size_t i, int error)
+{
+    struct async_buffer *b = &async->buffers[i];
+
+    if (b->busy)
+    {
+        b->busy = 0;
+        --async->in_flight;
+    }
+
+    if (error && !async->error) async->error = error;
+
+    if (async->completion) async->completion(b->done, error, async->context);
+}
@@ -0,0 +1,231 @@
+#define _GNU_SOURCE
+#include "internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*******************************************************************************
+ * OVERVIEW
+ *
+ * Moves blob payloads between file descriptors without holding them in user
+ * space.
+ *
+ * Each copy tries copy_file_range() first, which lets the filesystem share or
+ * clone extents, then sendfile(), which works for any output, then splice(),
+ * for outputs that are pipes.  A method that the kernel rejects for this pair
+ * of descriptors is abandoned for the next, ending in a pread()/write() loop
+ * through a small buffer.
+ ******************************************************************************/
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/*
+ * The most that is handed to the kernel in one call.  The system calls cap
+ * their own transfers at a little under 2GB.
+ */
+#define COPY_CHUNK (1UL << 30)
+
+/*
+ * The size of the buffer used when the kernel cannot copy directly.
+ */
+#define COPY_BUFFER_SIZE (64 * 1024)
+
+/*******************************************************************************
+ * TYPES
+ ******************************************************************************/
+
+enum method
+{
+    METHOD_COPY_FILE_RANGE,
+    METHOD_SENDFILE,
+    METHOD_SPLICE,
+    METHOD_BUFFER
+};
+
+/*******************************************************************************
+ * COPY FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Returns 1 if errno indicates that a method does not support the descriptors
+ * it was given (rather than that the copy itself failed), otherwise 0.
+ */
+static int is_unsupported(void);
+
+/*
+ * Copies up to size bytes from in at *offset to out through a buffer,
+ * advancing *offset.
+ *
+ * Returns the number of bytes copied, 0 at the end of in, or -1 on failure.
+ */
+static ssize_t copy_buffered(int in, off_t *offset, int out, size_t size);
+
+/*******************************************************************************
+ * COPY FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+int tioc_fd_size(int fd, size_t *size, const char *caller)
+{
+    struct stat st;
+
+    if (-1 == fstat(fd, &st))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "%s(): Unable to stat descriptor %d.",
+            caller,
+            fd
+        );
+        return -1;
+    }
+
+    if (!S_ISREG(st.st_mode))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "%s(): Descriptor %d is not a regular file.",
+            caller,
+            fd
+        );
+        return -1;
+    }
+
+    if ((unsigned long long)st.st_size >= SIZE_MAX)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_LIMIT,
+            "%s(): Descriptor %d is too large.",
+            caller,
+            fd
+        );
+        return -1;
+    }
+
+    *size = (size_t)st.st_size;
+    return 0;
+}
+
+int tioc_copy_range
+(
+    int in,
+    off_t offset,
+    int out,
+    size_t size,
+    const char *caller
+)
+{
+    enum method method = METHOD_COPY_FILE_RANGE;
+    size_t chunk;
+    ssize_t n = 0;
+
+    while (size)
+    {
+        chunk = size < COPY_CHUNK ? size : COPY_CHUNK;
+
+        switch (method)
+        {
+            case METHOD_COPY_FILE_RANGE:
+                n = copy_file_range(in, &offset, out, NULL, chunk, 0);
+                break;
+
+            case METHOD_SENDFILE:
+                n = sendfile(out, in, &offset, chunk);
+                break;
+
+            case METHOD_SPLICE:
+                n = splice(in, &offset, out, NULL, chunk, SPLICE_F_MOVE);
+                break;
+
+            case METHOD_BUFFER:
+                n = copy_buffered(in, &offset, out, chunk);
+                break;
+        }
+
+        if (-1 == n)
+        {
+            if (EINTR == errno) continue;
+
+            if (METHOD_BUFFER != method && is_unsupported())
+            {
+                ++method;
+                continue;
+            }
+
+            tioc_e(TIOC_ERROR_IO, "%s(): Unable to copy payload.", caller);
+            return -1;
+        }
+
+        if (!n)
+        {
+            tioc_e
+            (
+                TIOC_ERROR_IO,
+                "%s(): Payload truncated by %zu bytes.",
+                caller,
+                size
+            );
+            return -1;
+        }
+
+        size -= (size_t)n;
+    }
+
+    return 0;
+}
+
+int tioc_write_data(int out, const char *data, size_t size)
+{
+    ssize_t n;
+
+    while (size)
+    {
+        if (-1 == (n = write(out, data, size)))
+        {
+            if (EINTR == errno) continue;
+            return -1;
+        }
+
+        data += n;
+        size -= (size_t)n;
+    }
+
+    return 0;
+}
+
+static int is_unsupported(void)
+{
+    switch (errno)
+    {
+        case EINVAL:
+        case EXDEV:
+        case ENOSYS:
+        case EOPNOTSUPP:
+        case EBADF:
+        case ESPIPE:
+            return 1;
+    }
+
+    return 0;
+}
+
+static ssize_t copy_buffered(int in, off_t *offset, int out, size_t size)
+{
+    char buffer[COPY_BUFFER_SIZE];
+    ssize_t n;
+
+    if (size > sizeof(buffer)) size = sizeof(buffer);
+
+    if (-1 == (n = pread(in, buffer, size, *offset))) return -1;
+    if (n && -1 == tioc_write_data(out, buffer, (size_t)n)) return -1;
+
+    *offset += n;
+    return n;
+}
@@ -0,0 +1,144 @@
+#include "tioc.h"
+#include "internal.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+/*******************************************************************************
+ * OVERVIEW
+ *
+ * A failure is formatted once, where it is detected, into storage that belongs
+ * to the thread, which both the handler and tioc_last_error_message() then
+ * use.  The messages of the functions that pass the failure on are only
+ * formatted when there is a handler to receive them.
+ ******************************************************************************/
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/*
+ * The size of a formatted message, including the terminator.  Longer messages
+ * are truncated.
+ */
+#define ERROR_MESSAGE_SIZE 1024
+
+/*******************************************************************************
+ * TYPES
+ ******************************************************************************/
+
+struct last_error
+{
+    tioc_error_t error;
+    char message[ERROR_MESSAGE_SIZE];
+};
+
+/*******************************************************************************
+ * VARIABLES
+ ******************************************************************************/
+
+static __thread struct last_error last_error;
+
+/*
+ * Set by tioc_set_quiet().
+ */
+static __thread int quiet;
+
+/*
+ * Set by tioc_set_error_handler().
+ */
+static tioc_error_handler_t handler = tioc_print_error;
+static void *handler_context;
+
+/*******************************************************************************
+ * ERROR FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+void tioc_set_error_handler(tioc_error_handler_t h, void *context)
+{
+    handler = h;
+    handler_context = context;
+}
+
+void tioc_print_error(tioc_error_t error, const char *message, void *context)
+{
+    (void)error;
+    (void)context;
+
+    fprintf(stderr, "libtioc: %s\n", message);
+}
+
+tioc_error_t tioc_last_error(void)
+{
+    return last_error.error;
+}
+
+const char *tioc_last_error_message(void)
+{
+    if (!last_error.message[0]) return tioc_error_string(last_error.error);
+
+    return last_error.message;
+}
+
+const char *tioc_error_string(tioc_error_t error)
+{
+    switch (error)
+    {
+        case TIOC_ERROR_NONE:     return "No error";
+        case TIOC_ERROR_ARGUMENT: return "Invalid argument";
+        case TIOC_ERROR_MEMORY:   return "Out of memory";
+        case TIOC_ERROR_IO:       return "Input/output error";
+        case TIOC_ERROR_END:      return "Unexpected end of input";
+        case TIOC_ERROR_FORMAT:   return "Malformed input";
+        case TIOC_ERROR_LABEL:    return "Label mismatch";
+        case TIOC_ERROR_TYPE:     return "Type mismatch";
+        case TIOC_ERROR_MISMATCH: return "Value mismatch";
+        case TIOC_ERROR_LIMIT:    return "Length exceeds limit";
+        case TIOC_ERROR_CAPACITY: return "Buffer too small";
+        case TIOC_ERROR_CHECKSUM: return "Checksum mismatch";
+    }
+
+    return "Unknown error";
+}
+
+int tioc_set_quiet(int q)
+{
+    int previous = quiet;
+
+    quiet = q;
+    return previous;
+}
+
+void tioc_e(tioc_error_t error, const char *fmt, ...)
+{
+    va_list args;
+
+    last_error.error = error;
+
+    va_start(args, fmt);
+    vsnprintf(last_error.message, sizeof(last_error.message), fmt, args);
+    va_end(args);
+
+    if (!handler || quiet) return;
+
+    handler(error, last_error.message, handler_context);
+}
+
+void tioc_w(const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    tioc_wv(fmt, args);
+    va_end(args);
+}
+
+void tioc_wv(const char *fmt, va_list args)
+{
+    char message[ERROR_MESSAGE_SIZE];
+
+    if (!handler || quiet) return;
+
+    vsnprintf(message, sizeof(message), fmt, args);
+    handler(last_error.error, message, handler_context);
+}
@@ -0,0 +1,1106 @@
+#include "tioc.h"
+#include "internal.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*******************************************************************************
+ * OVERVIEW
+ *
+ * Sidecar indexes, which let a tioc_reader_t jump to a record without reading
+ * everything before it.
+ *
+ * The index is itself tioc data.  It starts with a header:
+ *
+ *     tioc_index:<version>
+ *     size:<size of the indexed file>
+ *     block_records:<records per block>
+ *     records:<number of records>
+ *     labels:<number of distinct labels>
+ *     label:<length>:<label>              (once per label)
+ *     blocks:<number of blocks>
+ *
+ * which is followed by, for each block:
+ *
+ *     offset:<offset of the block's first record>
+ *     first:<number of the block's first record>
+ *     records:<number of records in the block>
+ *     set:<length>:<bitmap of the labels that appear in the block>
+ *     ranges:<number of ranges>
+ *     id:<label number>                   (once per range)
+ *     min:<smallest value>
+ *     max:<largest value>
+ *
+ * A label has a range in a block if every one of its values in the block is
+ * unsigned.  Labels are numbered in order of first appearance, and bit n of a
+ * block's set (bit n % 8 of byte n / 8) is set if label n appears in it.
+ ******************************************************************************/
+
+/*
+ * The version written to (and required in) the header.
+ */
+#define INDEX_VERSION 1
+
+/*******************************************************************************
+ * TYPES
+ ******************************************************************************/
+
+struct range
+{
+    size_t label;
+    unsigned long long min;
+    unsigned long long max;
+};
+
+struct block
+{
+    size_t offset;
+    size_t first;
+    size_t records;
+
+    unsigned char *set;
+    size_t set_size;
+
+    struct range *ranges;
+    size_t range_count;
+};
+
+struct tioc_index
+{
+    size_t size;
+    size_t block_records;
+    size_t records;
+
+    tioc_label_t *labels;
+    size_t label_count;
+    size_t label_capacity;
+
+    struct block *blocks;
+    size_t block_count;
+    size_t block_capacity;
+};
+
+/*
+ * What has been seen of a label in the block being built.
+ */
+struct label_stats
+{
+    int seen;
+    int is_unsigned;
+    unsigned long long min;
+    unsigned long long max;
+};
+
+/*
+ * The labels of the index file itself.
+ */
+struct index_labels
+{
+    tioc_label_t version;
+    tioc_label_t size;
+    tioc_label_t block_records;
+    tioc_label_t records;
+    tioc_label_t labels;
+    tioc_label_t label;
+    tioc_label_t blocks;
+    tioc_label_t offset;
+    tioc_label_t first;
+    tioc_label_t set;
+    tioc_label_t ranges;
+    tioc_label_t id;
+    tioc_label_t min;
+    tioc_label_t max;
+};
+
+/*******************************************************************************
+ * INDEX FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Initialises the labels of the index file.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int init_index_labels(struct index_labels *l);
+
+/*
+ * Sets *id to the number of the label with the prefix given, adding it to the
+ * index if it is not already there.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int add_label
+(
+    tioc_index_t *index,
+    const char *prefix,
+    size_t length,
+    size_t *id
+);
+
+/*
+ * Returns the number of the label, or SIZE_MAX if it is not in the index.
+ */
+static size_t find_label(const tioc_index_t *index, const tioc_label_t *label);
+
+/*
+ * Appends an empty block to the index.
+ *
+ * Returns NULL on failure.
+ */
+static struct block *add_block(tioc_index_t *index);
+
+/*
+ * Fills in the label set and ranges of the block from stats, and then clears
+ * stats for the next block.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int finish_block
+(
+    const tioc_index_t *index,
+    struct block *block,
+    struct label_stats *stats
+);
+
+/*
+ * Returns the number of the last block that starts at or before offset.
+ */
+static size_t find_block(const tioc_index_t *index, size_t offset);
+
+/*
+ * Returns 1 if the label appears in the block, otherwise 0.
+ */
+static int has_label(const struct block *block, size_t id);
+
+/*
+ * Returns the block's range for the label, or NULL if it has none.
+ */
+static const struct range *find_range(const struct block *block, size_t id);
+
+/*
+ * Reads an unsigned value that must fit in a size_t.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int read_size
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    size_t *value
+);
+
+/*
+ * Checks that the index can be used with the reader.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int check_index
+(
+    const tioc_reader_t *reader,
+    const tioc_index_t *index,
+    const char *caller
+);
+
+/*
+ * Implements tioc_reader_seek_label() (if value is NULL) and
+ * tioc_reader_seek_unsigned().
+ */
+static int seek_match
+(
+    tioc_reader_t *reader,
+    const tioc_index_t *index,
+    const tioc_label_t *label,
+    const unsigned long long *value,
+    const char *caller
+);
+
+/*******************************************************************************
+ * INDEX FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+static int init_index_labels(struct index_labels *l)
+{
+    if (-1 == tioc_label_init(&l->version, "tioc_index") ||
+        -1 == tioc_label_init(&l->size, "size") ||
+        -1 == tioc_label_init(&l->block_records, "block_records") ||
+        -1 == tioc_label_init(&l->records, "records") ||
+        -1 == tioc_label_init(&l->labels, "labels") ||
+        -1 == tioc_label_init(&l->label, "label") ||
+        -1 == tioc_label_init(&l->blocks, "blocks") ||
+        -1 == tioc_label_init(&l->offset, "offset") ||
+        -1 == tioc_label_init(&l->first, "first") ||
+        -1 == tioc_label_init(&l->set, "set") ||
+        -1 == tioc_label_init(&l->ranges, "ranges") ||
+        -1 == tioc_label_init(&l->id, "id") ||
+        -1 == tioc_label_init(&l->min, "min") ||
+        -1 == tioc_label_init(&l->max, "max"))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int add_label
+(
+    tioc_index_t *index,
+    const char *prefix,
+    size_t length,
+    size_t *id
+)
+{
+    tioc_label_t *labels, *label;
+    unsigned int hash;
+    size_t i;
+
+    hash = tioc_hash_label(prefix, length);
+
+    for (i = 0; i < index->label_count; ++i)
+    {
+        label = &index->labels[i];
+
+        if (hash == label->hash && length == label->length &&
+            !memcmp(prefix, label->prefix, length))
+        {
+            *id = i;
+            return 0;
+        }
+    }
+
+    if (length < 2 || length > TIOC_LABEL_MAX + 1)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "add_label(): Invalid label length %zu.",
+            length
+        );
+        return -1;
+    }
+
+    if (index->label_count == index->label_capacity)
+    {
+        index->label_capacity = index->label_capacity
+                              ? 2 * index->label_capacity
+                              : 16;
+
+        labels = realloc(index->labels,
+                index->label_capacity * sizeof(*labels));
+        if (!labels)
+        {
+            tioc_e(TIOC_ERROR_MEMORY, "add_label(): realloc() failed.");
+            return -1;
+        }
+
+        index->labels = labels;
+    }
+
+    label = &index->labels[index->label_count];
+    memcpy(label->prefix, prefix, length);
+    label->prefix[length] = 0;
+    label->length = length;
+    label->hash = hash;
+
+    *id = index->label_count++;
+    return 0;
+}
+
+static size_t find_label(const tioc_index_t *index, const tioc_label_t *label)
+{
+    const tioc_label_t *l;
+    size_t i;
+
+    for (i = 0; i < index->label_count; ++i)
+    {
+        l = &index->labels[i];
+
+        if (label->hash == l->hash && label->length == l->length &&
+            !memcmp(label->prefix, l->prefix, l->length))
+        {
+            return i;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+static struct block *add_block(tioc_index_t *index)
+{
+    struct block *blocks, *block;
+
+    if (index->block_count == index->block_capacity)
+    {
+        index->block_capacity = index->block_capacity
+                              ? 2 * index->block_capacity
+                              : 64;
+
+        blocks = realloc(index->blocks,
+                index->block_capacity * sizeof(*blocks));
+        if (!blocks)
+        {
+            tioc_e(TIOC_ERROR_MEMORY, "add_block(): realloc() failed.");
+            return NULL;
+        }
+
+        index->blocks = blocks;
+    }
+
+    block = &index->blocks[index->block_count++];
+    memset(block, 0, sizeof(*block));
+
+    return block;
+}
+
+static int finish_block
+(
+    const tioc_index_t *index,
+    struct block *block,
+    struct label_stats *stats
+)
+{
+    size_t i, r = 0;
+
+    block->set_size = (index->label_count + 7) / 8;
+    block->range_count = 0;
+
+    for (i = 0; i < index->label_count; ++i)
+    {
+        if (stats[i].seen && stats[i].is_unsigned) ++block->range_count;
+    }
+
+    if (!(block->set = calloc(block->set_size ? block->set_size : 1, 1)) ||
+        (block->range_count && !(block->ranges =
+            malloc(block->range_count * sizeof(*block->ranges)))))
+    {
+        tioc_e(TIOC_ERROR_MEMORY, "finish_block(): Unable to allocate memory.");
+        return -1;
+    }
+
+    for (i = 0; i < index->label_count; ++i)
+    {
+        if (!stats[i].seen) continue;
+
+        block->set[i / 8] |= (unsigned char)(1 << (i % 8));
+
+        if (stats[i].is_unsigned)
+        {
+            block->ranges[r].label = i;
+            block->ranges[r].min = stats[i].min;
+            block->ranges[r].max = stats[i].max;
+            ++r;
+        }
+
+        stats[i].seen = 0;
+    }
+
+    return 0;
+}
+
+static size_t find_block(const tioc_index_t *index, size_t offset)
+{
+    size_t lo = 0, hi = index->block_count, mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+
+        if (index->blocks[mid].offset <= offset) lo = mid + 1;
+        else hi = mid;
+    }
+
+    return lo ? lo - 1 : 0;
+}
+
+static int has_label(const struct block *block, size_t id)
+{
+    if (id / 8 >= block->set_size) return 0;
+
+    return (block->set[id / 8] >> (id % 8)) & 1;
+}
+
+static const struct range *find_range(const struct block *block, size_t id)
+{
+    size_t i;
+
+    for (i = 0; i < block->range_count; ++i)
+    {
+        if (id == block->ranges[i].label) return &block->ranges[i];
+    }
+
+    return NULL;
+}
+
+tioc_index_t *tioc_index_build(const char *filename, size_t block_records)
+{
+    tioc_reader_t *reader = NULL;
+    tioc_index_t *index = NULL;
+    struct label_stats *stats = NULL, *s;
+    size_t stats_count = 0;
+    struct block *block = NULL;
+    const struct tioc_group_field *field;
+    unsigned long long value;
+    size_t i, id, n;
+    int is_unsigned;
+    int rc = -1;
+
+    if (!block_records) block_records = TIOC_INDEX_BLOCK_RECORDS;
+
+    if (!(reader = tioc_reader_map(filename))) goto cleanup;
+
+    if (!(index = calloc(1, sizeof(*index))))
+    {
+        tioc_e(TIOC_ERROR_MEMORY, "tioc_index_build(): calloc() failed.");
+        goto cleanup;
+    }
+
+    index->size = reader->size;
+    index->block_records = block_records;
+
+    while (!tioc_reader_eof(reader))
+    {
+        if (!block || block->records == block_records)
+        {
+            if (block && -1 == finish_block(index, block, stats))
+                goto cleanup;
+
+            if (!(block = add_block(index))) goto cleanup;
+
+            block->offset = reader->position;
+            block->first = index->records;
+        }
+
+        if (-1 == tioc_reader_begin_group(reader, 0))
+        {
+            tioc_w
+            (
+                "tioc_index_build(): Unable to read record %zu of '%s'.",
+                index->records,
+                filename
+            );
+            goto cleanup;
+        }
+
+        for (i = 0; i < reader->group.count; ++i)
+        {
+            field = &reader->group.fields[i];
+
+            if (-1 == add_label(index, reader->data + field->label,
+                        field->length, &id))
+            {
+                goto cleanup;
+            }
+
+            if (index->label_count > stats_count)
+            {
+                s = realloc(stats, index->label_capacity * sizeof(*stats));
+                if (!s)
+                {
+                    tioc_e
+                    (
+                        TIOC_ERROR_MEMORY,
+                        "tioc_index_build(): realloc() failed."
+                    );
+                    goto cleanup;
+                }
+
+                memset(s + stats_count, 0,
+                        (index->label_capacity - stats_count) * sizeof(*s));
+                stats = s;
+                stats_count = index->label_capacity;
+            }
+
+            /*
+             * The scan found a newline after the value, so there is always a
+             * byte after any digits.
+             */
+            n = tioc_parse_unsigned
+                (
+                    reader->data + field->value,
+                    reader->size - field->value,
+                    ULLONG_MAX,
+                    &value
+                );
+            is_unsigned = n && '\n' == reader->data[field->value + n];
+
+            s = &stats[id];
+            if (!s->seen)
+            {
+                s->seen = 1;
+                s->is_unsigned = is_unsigned;
+                s->min = s->max = value;
+            }
+            else if (s->is_unsigned && !is_unsigned)
+            {
+                s->is_unsigned = 0;
+            }
+            else if (s->is_unsigned)
+            {
+                if (value < s->min) s->min = value;
+                if (value > s->max) s->max = value;
+            }
+        }
+
+        tioc_reader_end_group(reader);
+
+        ++block->records;
+        ++index->records;
+    }
+
+    if (block && -1 == finish_block(index, block, stats)) goto cleanup;
+
+    rc = 0;
+
+cleanup:
+    free(stats);
+    tioc_reader_close(reader);
+
+    if (-1 == rc)
+    {
+        tioc_index_free(index);
+        index = NULL;
+    }
+
+    return index;
+}
+
+int tioc_index_save(const tioc_index_t *index, const char *filename)
+{
+    struct index_labels l;
+    const struct block *block;
+    const struct range *range;
+    tioc_writer_t *writer = NULL;
+    size_t i, j;
+    int fd, rc = -1;
+
+    if (!index || !filename)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "tioc_index_save(): Invalid argument.");
+        return -1;
+    }
+
+    if (-1 == init_index_labels(&l)) return -1;
+
+    if (-1 == (fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644)))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "tioc_index_save(): Unable to open file '%s'.",
+            filename
+        );
+        return -1;
+    }
+
+    if (!(writer = tioc_writer_open(fd, 0)))
+    {
+        close(fd);
+        return -1;
+    }
+
+    if (-1 == tioc_writer_write_unsigned_l(writer, &l.version, INDEX_VERSION) ||
+        -1 == tioc_writer_write_unsigned_l(writer, &l.size, index->size) ||
+        -1 == tioc_writer_write_unsigned_l(writer, &l.block_records,
+            index->block_records) ||
+        -1 == tioc_writer_write_unsigned_l(writer, &l.records,
+            index->records) ||
+        -1 == tioc_writer_write_unsigned_l(writer, &l.labels,
+            index->label_count))
+    {
+        goto cleanup;
+    }
+
+    for (i = 0; i < index->label_count; ++i)
+    {
+        if (-1 == tioc_writer_write_blob_l(writer, &l.label,
+                    index->labels[i].prefix, index->labels[i].length - 1))
+        {
+            goto cleanup;
+        }
+    }
+
+    if (-1 == tioc_writer_write_unsigned_l(writer, &l.blocks,
+                index->block_count))
+    {
+        goto cleanup;
+    }
+
+    for (i = 0; i < index->block_count; ++i)
+    {
+        block = &index->blocks[i];
+
+        if (-1 == tioc_writer_write_unsigned_l(writer, &l.offset,
+                    block->offset) ||
+            -1 == tioc_writer_write_unsigned_l(writer, &l.first,
+                block->first) ||
+            -1 == tioc_writer_write_unsigned_l(writer, &l.records,
+                block->records) ||
+            -1 == tioc_writer_write_blob_l(writer, &l.set,
+                (const char*)block->set, block->set_size) ||
+            -1 == tioc_writer_write_unsigned_l(writer, &l.ranges,
+                block->range_count))
+        {
+            goto cleanup;
+        }
+
+        for (j = 0; j < block->range_count; ++j)
+        {
+            range = &block->ranges[j];
+
+            if (-1 == tioc_writer_write_unsigned_l(writer, &l.id,
+                        range->label) ||
+                -1 == tioc_writer_write_unsigned_l(writer, &l.min,
+                    range->min) ||
+                -1 == tioc_writer_write_unsigned_l(writer, &l.max,
+                    range->max))
+            {
+                goto cleanup;
+            }
+        }
+    }
+
+    rc = 0;
+
+cleanup:
+    if (-1 == tioc_writer_close(writer)) rc = -1;
+
+    if (-1 == rc)
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "tioc_index_save(): Unable to write file '%s'.",
+            filename
+        );
+
+    return rc;
+}
+
+static int read_size
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    size_t *value
+)
+{
+    unsigned long long v;
+
+    if (-1 == tioc_reader_read_unsigned_l(reader, label, &v)) return -1;
+
+    if (v > SIZE_MAX)
+    {
+        tioc_e(TIOC_ERROR_FORMAT, "read_size(): Value %llu is too large.", v);
+        return -1;
+    }
+
+    *value = (size_t)v;
+    return 0;
+}
+
+tioc_index_t *tioc_index_load(const char *filename)
+{
+    struct index_labels l;
+    tioc_reader_t *reader = NULL;
+    tioc_index_t *index = NULL;
+    struct block *block;
+    struct range *range;
+    tioc_view_t view;
+    char prefix[TIOC_LABEL_MAX + 1];
+    char *set;
+    unsigned long long version;
+    size_t count, i, j, id, records = 0;
+    int rc = -1;
+
+    if (-1 == init_index_labels(&l)) return NULL;
+
+    if (!(reader = tioc_reader_map(filename))) goto cleanup;
+
+    if (!(index = calloc(1, sizeof(*index))))
+    {
+        tioc_e(TIOC_ERROR_MEMORY, "tioc_index_load(): calloc() failed.");
+        goto cleanup;
+    }
+
+    if (-1 == tioc_reader_read_unsigned_l(reader, &l.version, &version))
+        goto cleanup;
+
+    if (INDEX_VERSION != version)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "tioc_index_load(): Unsupported version %llu.",
+            version
+        );
+        goto cleanup;
+    }
+
+    if (-1 == read_size(reader, &l.size, &index->size) ||
+        -1 == read_size(reader, &l.block_records, &index->block_records) ||
+        -1 == read_size(reader, &l.records, &index->records) ||
+        -1 == read_size(reader, &l.labels, &count))
+    {
+        goto cleanup;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        if (-1 == tioc_reader_read_blob_view_l(reader, &l.label, &view))
+            goto cleanup;
+
+        /*
+         * add_label() wants the prefix, colon included, and the view is
+         * followed by a newline rather than a colon.
+         */
+        if (view.size < 1 || view.size > TIOC_LABEL_MAX ||
+            memchr(view.data, ':', view.size))
+        {
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "tioc_index_load(): Invalid label %zu.",
+                i
+            );
+            goto cleanup;
+        }
+
+        memcpy(prefix, view.data, view.size);
+        prefix[view.size] = ':';
+
+        if (-1 == add_label(index, prefix, view.size + 1, &id)) goto cleanup;
+
+        if (id != i)
+        {
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "tioc_index_load(): Duplicate label %zu.",
+                i
+            );
+            goto cleanup;
+        }
+    }
+
+    if (-1 == read_size(reader, &l.blocks, &count)) goto cleanup;
+
+    for (i = 0; i < count; ++i)
+    {
+        if (!(block = add_block(index))) goto cleanup;
+
+        if (-1 == read_size(reader, &l.offset, &block->offset) ||
+            -1 == read_size(reader, &l.first, &block->first) ||
+            -1 == read_size(reader, &l.records, &block->records) ||
+            -1 == tioc_reader_read_blob_l(reader, &l.set, &set,
+                &block->set_size))
+        {
+            goto cleanup;
+        }
+
+        block->set = (unsigned char*)set;
+
+        if (-1 == read_size(reader, &l.ranges, &block->range_count))
+            goto cleanup;
+
+        if (block->offset > index->size || block->first != records ||
+            (i && block->offset <= index->blocks[i - 1].offset))
+        {
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "tioc_index_load(): Block %zu is inconsistent.",
+                i
+            );
+            goto cleanup;
+        }
+
+        records += block->records;
+
+        if (block->range_count > index->label_count)
+        {
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "tioc_index_load(): Block %zu has too many ranges.",
+                i
+            );
+            goto cleanup;
+        }
+
+        if (block->range_count && !(block->ranges =
+                    calloc(block->range_count, sizeof(*block->ranges))))
+        {
+            tioc_e(TIOC_ERROR_MEMORY, "tioc_index_load(): calloc() failed.");
+            goto cleanup;
+        }
+
+        for (j = 0; j < block->range_count; ++j)
+        {
+            range = &block->ranges[j];
+
+            if (-1 == read_size(reader, &l.id, &range->label) ||
+                -1 == tioc_reader_read_unsigned_l(reader, &l.min,
+                    &range->min) ||
+                -1 == tioc_reader_read_unsigned_l(reader, &l.max,
+                    &range->max))
+            {
+                goto cleanup;
+            }
+
+            if (range->label >= index->label_count)
+            {
+                tioc_e
+                (
+                    TIOC_ERROR_FORMAT,
+                    "tioc_index_load(): Invalid range in block %zu.",
+                    i
+                );
+                goto cleanup;
+            }
+        }
+    }
+
+    if (records != index->records || !tioc_reader_eof(reader))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "tioc_index_load(): Index '%s' is inconsistent.",
+            filename
+        );
+        goto cleanup;
+    }
+
+    rc = 0;
+
+cleanup:
+    tioc_reader_close(reader);
+
+    if (-1 == rc)
+    {
+        tioc_index_free(index);
+        index = NULL;
+    }
+
+    return index;
+}
+
+void tioc_index_free(tioc_index_t *index)
+{
+    size_t i;
+
+    if (!index) return;
+
+    for (i = 0; i < index->block_count; ++i)
+    {
+        free(index->blocks[i].set);
+        free(index->blocks[i].ranges);
+    }
+
+    free(index->blocks);
+    free(index->labels);
+    free(index);
+}
+
+size_t tioc_index_records(const tioc_index_t *index)
+{
+    return index->records;
+}
+
+/*******************************************************************************
+ * SEEK FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+static int check_index
+(
+    const tioc_reader_t *reader,
+    const tioc_index_t *index,
+    const char *caller
+)
+{
+    if (!reader || !index)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "%s(): Invalid argument.", caller);
+        return -1;
+    }
+
+    if (reader->group.active)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "%s(): A group is active.", caller);
+        return -1;
+    }
+
+    if (reader->size != index->size)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "%s(): The index does not match the data.",
+            caller
+        );
+        return -1;
+    }
+
+    return 0;
+}
+
+int tioc_reader_seek_record
+(
+    tioc_reader_t *reader,
+    const tioc_index_t *index,
+    size_t record
+)
+{
+    const struct block *block;
+    size_t lo = 0, hi, mid, position, i;
+
+    if (-1 == check_index(reader, index, "tioc_reader_seek_record"))
+        return -1;
+
+    if (record >= index->records)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_seek_record(): Record %zu is past the end.",
+            record
+        );
+        return -1;
+    }
+
+    hi = index->block_count;
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+
+        if (index->blocks[mid].first <= record) lo = mid + 1;
+        else hi = mid;
+    }
+
+    block = &index->blocks[lo - 1];
+    position = reader->position;
+    reader->position = block->offset;
+
+    for (i = block->first; i < record; ++i)
+    {
+        if (-1 == tioc_reader_begin_group(reader, 0) ||
+            -1 == tioc_reader_end_group(reader))
+        {
+            tioc_w("tioc_reader_seek_record(): Unable to skip record %zu.", i);
+            reader->position = position;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int seek_match
+(
+    tioc_reader_t *reader,
+    const tioc_index_t *index,
+    const tioc_label_t *label,
+    const unsigned long long *value,
+    const char *caller
+)
+{
+    const struct block *block;
+    const struct range *range;
+    const struct tioc_group_field *field;
+    unsigned long long actual;
+    size_t id, b, end, position, start, n;
+    int matched;
+
+    if (-1 == check_index(reader, index, caller)) return -1;
+
+    if (!label)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "%s(): Invalid 'label' argument.", caller);
+        return -1;
+    }
+
+    if (SIZE_MAX == (id = find_label(index, label))) return 1;
+
+    position = reader->position;
+
+    for (b = find_block(index, position); b < index->block_count; ++b)
+    {
+        block = &index->blocks[b];
+
+        if (!has_label(block, id)) continue;
+
+        if (value && (range = find_range(block, id)) &&
+            (*value < range->min || *value > range->max))
+        {
+            continue;
+        }
+
+        end = b + 1 < index->block_count
+            ? index->blocks[b + 1].offset
+            : reader->size;
+
+        reader->position = position > block->offset ? position : block->offset;
+
+        while (reader->position < end)
+        {
+            start = reader->position;
+
+            if (-1 == tioc_reader_begin_group(reader, 0))
+            {
+                tioc_w("%s(): Unable to read record.", caller);
+                reader->position = position;
+                return -1;
+            }
+
+            field = tioc_reader_find_field(reader, label->prefix,
+                    label->length, label->hash);
+            matched = NULL != field;
+
+            if (field && value)
+            {
+                n = tioc_parse_unsigned
+                    (
+                        reader->data + field->value,
+                        reader->size - field->value,
+                        ULLONG_MAX,
+                        &actual
+                    );
+                matched = n && '\n' == reader->data[field->value + n] &&
+                          *value == actual;
+            }
+
+            tioc_reader_end_group(reader);
+
+            if (matched)
+            {
+                reader->position = start;
+                return 0;
+            }
+        }
+    }
+
+    reader->position = position;
+    return 1;
+}
+
+int tioc_reader_seek_label
+(
+    tioc_reader_t *reader,
+    const tioc_index_t *index,
+    const tioc_label_t *label
+)
+{
+    return seek_match(reader, index, label, NULL, "tioc_reader_seek_label");
+}
+
+int tioc_reader_seek_unsigned
+(
+    tioc_reader_t *reader,
+    const tioc_index_t *index,
+    const tioc_label_t *label,
+    unsigned long long value
+)
+{
+    return seek_match(reader, index, label, &value,
+            "tioc_reader_seek_unsigned");
+}
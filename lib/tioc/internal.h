@@ -0,0 +1,563 @@
+#ifndef LIB_TIOC_INTERNAL_H
+#define LIB_TIOC_INTERNAL_H
+
+#include "tioc.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*******************************************************************************
+ * OVERVIEW
+ *
+ * Declarations shared between the translation units of libtioc.  Nothing in
+ * this file is part of the public interface, and it is not installed.
+ ******************************************************************************/
+
+/*
+ * The maximum number of decimal digits in an unsigned long long.
+ */
+#define TIOC_UNSIGNED_MAX 20
+
+/*
+ * The length of a UUID in its canonical textual form (without terminator).
+ */
+#define TIOC_UUID_LENGTH 36
+
+/*
+ * The maximum number of bytes in an LEB128-encoded unsigned long long.
+ */
+#define TIOC_VARINT_MAX 10
+
+/*
+ * The bytes at the start of binary data.  The first of them cannot start a
+ * label, so text data is never mistaken for binary.
+ */
+#define TIOC_BINARY_MAGIC "\x89tioc\x01\r\n"
+#define TIOC_BINARY_MAGIC_LENGTH 8
+
+/*
+ * The bytes at the start of checked data (binary data with checksums), which
+ * are as long as TIOC_BINARY_MAGIC.
+ */
+#define TIOC_CHECKED_MAGIC "\x89tioc\x02\r\n"
+
+/*
+ * The length of the CRC32C that follows each field of checked data.
+ */
+#define TIOC_CHECKSUM_LENGTH 4
+
+/*
+ * The number of low bits of a binary tag that hold the kind of the field.
+ */
+#define TIOC_KIND_BITS 3
+
+/*
+ * Defined when building for x86, where vector versions of some routines are
+ * selected at run time.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define TIOC_X86 1
+#endif
+
+/*******************************************************************************
+ * TYPES
+ ******************************************************************************/
+
+/*
+ * The kinds of binary field.
+ */
+enum tioc_kind
+{
+    /*
+     * A varint value.
+     */
+    TIOC_KIND_UNSIGNED,
+
+    /*
+     * Sixteen raw bytes.
+     */
+    TIOC_KIND_UUID,
+
+    /*
+     * A varint length and that many bytes (strings and blobs).
+     */
+    TIOC_KIND_BLOB,
+
+    /*
+     * A varint length and that many bytes, holding a text value verbatim.
+     * This is only used for text values that the other kinds would not
+     * reproduce exactly (e.g. "007"), so that transcoding is lossless.  The
+     * read functions parse it as they would the text.
+     */
+    TIOC_KIND_RAW,
+
+    /*
+     * Defines the label with the id in the tag: a varint length and that
+     * many bytes of label.
+     */
+    TIOC_KIND_DEFINE
+};
+
+/*
+ * A field of either encoding, as returned by tioc_reader_next_field().
+ *
+ * The label and data point into the reader's data.
+ */
+struct tioc_any_field
+{
+    const char *label;
+    size_t length;
+    enum tioc_kind kind;
+    unsigned long long value;
+    uuid_t uuid;
+    const char *data;
+    size_t size;
+};
+
+/*
+ * A label defined in binary data: where its bytes are, and how many there are
+ * (without a colon).
+ */
+struct tioc_definition
+{
+    size_t offset;
+    size_t length;
+};
+
+/*
+ * A compiled tioc_field_t.
+ */
+struct tioc_schema_field
+{
+    tioc_label_t label;
+    tioc_type_t type;
+    size_t offset;
+    size_t size_offset;
+};
+
+struct tioc_schema
+{
+    size_t count;
+    struct tioc_schema_field fields[];
+};
+
+/*
+ * A field of a group: where its "<label>:" prefix starts, how long it is, and
+ * where its value starts.
+ */
+struct tioc_group_field
+{
+    size_t label;
+    size_t length;
+    unsigned int hash;
+    size_t value;
+};
+
+/*
+ * The index built by tioc_reader_begin_group().
+ *
+ * slots is an open-addressing hash table of slot_count (a power of two)
+ * entries, each of which is either 0 (empty) or one more than an index into
+ * fields.
+ */
+struct tioc_group
+{
+    int active;
+    size_t end;
+
+    struct tioc_group_field *fields;
+    size_t count;
+    size_t capacity;
+
+    size_t *slots;
+    size_t slot_count;
+};
+
+struct tioc_reader
+{
+    const char *data;
+    size_t size;
+    size_t position;
+
+    /*
+     * Set if the data is a mapping owned by the reader, in which case fd is
+     * the file that it maps (otherwise -1).
+     */
+    void *mapping;
+    int fd;
+
+    /*
+     * The largest string or blob accepted (see tioc_reader_set_limit()).
+     */
+    size_t limit;
+
+    struct tioc_group group;
+
+    /*
+     * Set if the data is binary, in which case definitions holds the labels
+     * defined so far, indexed by id.
+     */
+    int binary;
+    struct tioc_definition *definitions;
+    size_t definition_count;
+    size_t definition_capacity;
+
+    /*
+     * Set if the binary data is checked, in which case verified is the end of
+     * the last field whose checksum string_field() has verified, so that
+     * end_field() need not verify it again.
+     */
+    int checked;
+    size_t verified;
+};
+
+/*******************************************************************************
+ * ERROR FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Stops passing the calling thread's failures to the error handler if quiet is
+ * set, or starts again if it is not, for code that expects some of what it
+ * tries to fail.  Failures are still recorded as the last error.
+ *
+ * Returns the previous setting.
+ */
+int tioc_set_quiet(int quiet);
+
+/*
+ * Records a failure and its message, which is formatted once, as the thread's
+ * last error, and passes the message to the error handler.  fmt must start
+ * with "<function>(): ".
+ *
+ * This is for where a failure is detected; tioc_w() is for passing one on.
+ */
+void tioc_e(tioc_error_t error, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/*
+ * Passes a message to the error handler without changing the thread's last
+ * error, which should already have been set by whatever failed.
+ */
+void tioc_w(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/*
+ * As tioc_w(), using the arguments supplied.
+ */
+void tioc_wv(const char *fmt, va_list args);
+
+/*******************************************************************************
+ * LABEL FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Returns 1 if the label is valid, otherwise 0.
+ */
+int tioc_is_label_valid(const char *label);
+
+/*
+ * Returns the FNV-1a hash of the length bytes at prefix.  This is the hash
+ * stored in a tioc_label_t.
+ */
+unsigned int tioc_hash_label(const char *prefix, size_t length);
+
+/*
+ * Initialises label from the length bytes at name, which are not validated
+ * beyond containing no colon or newline and being no longer than
+ * TIOC_LABEL_MAX.  Used for labels that come from data rather than from the
+ * application.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_label_set(tioc_label_t *label, const char *name, size_t length);
+
+/*******************************************************************************
+ * ARENA FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Allocates size bytes from the arena or, if arena is NULL, with malloc().
+ *
+ * Returns NULL on failure.
+ */
+void *tioc_allocate(tioc_arena_t *arena, size_t size);
+
+/*
+ * Frees memory from tioc_allocate().  Memory from an arena is left for the
+ * arena to free.
+ */
+void tioc_release(tioc_arena_t *arena, void *p);
+
+/*******************************************************************************
+ * SMALL STRING FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Returns where a string of length bytes (and its terminator) should be stored
+ * in string: its inline buffer, its heap buffer, or a new heap buffer that
+ * replaces the old one.  string->length is not changed.
+ *
+ * Returns NULL on failure.
+ */
+char *tioc_string_reserve
+(
+    tioc_string_t *string,
+    size_t length,
+    const char *caller
+);
+
+/*******************************************************************************
+ * SCHEMA FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * As tioc_free_record(), but only for the first count fields of the schema.
+ * Used to undo a partially read record.
+ */
+void tioc_free_fields(const tioc_schema_t *schema, void *record, size_t count);
+
+/*******************************************************************************
+ * WRITER FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Writes a value verbatim.  In text, this is "<label>:<data>\n"; in binary, it
+ * is a TIOC_KIND_RAW field.  The caller is responsible for data being a value
+ * that reads back as the same field (e.g. one read from text).
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_writer_write_raw_l
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    const char *data,
+    size_t size
+);
+
+/*******************************************************************************
+ * READER FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Reads the next field, whatever its label and type, and moves the position
+ * past it.  Text values are classified as the kind that the writer would have
+ * produced them from, or as TIOC_KIND_RAW if no writer function produces
+ * exactly that text.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_next_field(tioc_reader_t *reader, struct tioc_any_field *field);
+
+/*
+ * Parses the text field at *pos without interpreting its value, and advances
+ * *pos past its newline.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_scan_field
+(
+    const tioc_reader_t *reader,
+    size_t *pos,
+    struct tioc_group_field *field
+);
+
+/*
+ * Checks the text field at *pos more strictly than tioc_reader_scan_field():
+ * that its label is valid, and that its value is a length and a payload of
+ * that length, a UUID or an unsigned value, followed by a newline.  Nothing is
+ * allocated.
+ *
+ * Returns -1 on failure, in which case *pos is the offset of the first bad
+ * byte, 0 on success, in which case *pos is moved past the newline.
+ */
+int tioc_reader_check_field(const tioc_reader_t *reader, size_t *pos);
+
+/*
+ * Returns the field of the reader's current group with the label given, or
+ * NULL if there is none.  Unlike the read functions, this does not warn.
+ */
+const struct tioc_group_field *tioc_reader_find_field
+(
+    const tioc_reader_t *reader,
+    const char *prefix,
+    size_t length,
+    unsigned int hash
+);
+
+/*******************************************************************************
+ * NUMBER FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Formats value in decimal into buffer, which must have room for at least
+ * TIOC_UNSIGNED_MAX bytes.  No terminator is written.
+ *
+ * This does not consult the locale, so it is safe to call from any thread
+ * regardless of what the application has passed to setlocale().
+ *
+ * Returns the number of bytes written.
+ */
+size_t tioc_format_unsigned(char *buffer, unsigned long long value);
+
+/*
+ * Parses the run of decimal digits at the start of text, which is size bytes
+ * long, into value.  Like tioc_format_unsigned(), this is locale-independent.
+ *
+ * Returns the number of digits consumed, or 0 if text does not start with a
+ * digit or the value exceeds max.
+ */
+size_t tioc_parse_unsigned
+(
+    const char *text,
+    size_t size,
+    unsigned long long max,
+    unsigned long long *value
+);
+
+/*
+ * Formats value as an LEB128 varint into buffer, which must have room for at
+ * least TIOC_VARINT_MAX bytes.
+ *
+ * Returns the number of bytes written.
+ */
+size_t tioc_format_varint(char *buffer, unsigned long long value);
+
+/*
+ * Parses the LEB128 varint at the start of data, which is size bytes long,
+ * into value.
+ *
+ * Returns the number of bytes consumed, or 0 if the varint is truncated or
+ * too large for an unsigned long long.
+ */
+size_t tioc_parse_varint
+(
+    const char *data,
+    size_t size,
+    unsigned long long *value
+);
+
+/*******************************************************************************
+ * COPY FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Sets *size to the size of fd, which must be a regular file.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_fd_size(int fd, size_t *size, const char *caller);
+
+/*
+ * Copies size bytes of in, starting at offset, to out (at its current
+ * position), moving the data within the kernel where possible.  in must
+ * support pread(), e.g. be a regular file; its own position is not changed.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_copy_range
+(
+    int in,
+    off_t offset,
+    int out,
+    size_t size,
+    const char *caller
+);
+
+/*
+ * Writes size bytes at data to out, retrying on partial writes and EINTR.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_write_data(int out, const char *data, size_t size);
+
+/*******************************************************************************
+ * ASYNC FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Creates the state for writing fd asynchronously from count buffers (at least
+ * 2) of size bytes each, rounded up to a whole number of pages.  See
+ * tioc_writer_open_async().
+ *
+ * Returns NULL on failure.
+ */
+struct tioc_async *tioc_async_create
+(
+    int fd,
+    size_t size,
+    size_t count,
+    tioc_write_completion_t completion,
+    void *context
+);
+
+/*
+ * Returns the buffer to be filled.
+ */
+char *tioc_async_buffer(struct tioc_async *async);
+
+/*
+ * Returns the size of each buffer.
+ */
+size_t tioc_async_size(const struct tioc_async *async);
+
+/*
+ * Starts writing the first used bytes of the buffer being filled, and sets
+ * *buffer to the next buffer to fill, waiting until it is free.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_async_submit(struct tioc_async *async, size_t used, char **buffer);
+
+/*
+ * Waits for all writes to complete, and leaves fd positioned after them.
+ *
+ * Returns -1 on failure (including that of an earlier write), 0 on success.
+ */
+int tioc_async_drain(struct tioc_async *async);
+
+/*
+ * Takes up writing from fd's current position, after something else has
+ * written to it following tioc_async_drain().
+ */
+void tioc_async_resume(struct tioc_async *async);
+
+/*
+ * Waits for all writes to complete, and frees the state.  fd is not closed.
+ *
+ * Returns -1 on failure, 0 on success.  The state is freed in either case.
+ */
+int tioc_async_destroy(struct tioc_async *async);
+
+/*******************************************************************************
+ * CHECKSUM FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Returns the CRC32C of the size bytes at data, continuing from crc, which is
+ * 0 to start with or the result of a previous call for the bytes before them.
+ */
+uint32_t tioc_crc32c(uint32_t crc, const char *data, size_t size);
+
+/*******************************************************************************
+ * UUID FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Formats uuid in its canonical lowercase form into buffer, which must have
+ * room for at least TIOC_UUID_LENGTH bytes.  No terminator is written.
+ *
+ * This is equivalent to uuid_unparse_lower() without the terminator.
+ */
+void tioc_format_uuid(char *buffer, const unsigned char *uuid);
+
+/*
+ * Parses the TIOC_UUID_LENGTH bytes at text (which need not be terminated)
+ * into uuid.  Upper and lower case hexadecimal digits are accepted, as they
+ * are by uuid_parse().  No more than TIOC_UUID_LENGTH bytes are read.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_parse_uuid(const char *text, unsigned char *uuid);
+
+#endif /* #ifndef LIB_TIOC_INTERNAL_H */
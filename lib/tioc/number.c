@@ -0,0 +1,465 @@
+#include "internal.h"
+#include <limits.h>
+#include <string.h>
+
+#ifdef TIOC_X86
+#include <immintrin.h>
+#endif
+
+/*******************************************************************************
+ * OVERVIEW
+ *
+ * Decimal formatting and parsing of unsigned values.  Neither direction
+ * consults the locale.
+ *
+ * Parsing handles at most TIOC_UNSIGNED_MAX digits, and always looks at 32
+ * bytes of input, so that the vector versions can find the end of the digits
+ * with one or two loads and a compare.  The last (up to) 16 digits are then
+ * right-aligned in a vector register and reduced to a single value with
+ * multiply-adds: pairs of digits, then pairs of pairs, and so on.  Whatever
+ * precedes them can only be four digits, which makes an exact overflow check
+ * against ULLONG_MAX cheap.
+ *
+ * On x86, SSE4.1 and AVX2 versions are selected at startup when the CPU
+ * supports them; elsewhere (and on older CPUs) a scalar version is used.
+ ******************************************************************************/
+
+/*
+ * ULLONG_MAX split into the digits above and below 10^16.
+ */
+#define HIGH_MAX 1844ULL
+#define LOW_MAX 6744073709551615ULL
+
+/*
+ * The number of bytes that a parse_t looks at.
+ */
+#define PARSE_WINDOW 32
+
+/*******************************************************************************
+ * TYPES
+ ******************************************************************************/
+
+/*
+ * Parses the leading digits of the PARSE_WINDOW bytes at text into value.
+ *
+ * Returns the number of digits, or 0 if there are none, there are more than
+ * TIOC_UNSIGNED_MAX, or the value does not fit in an unsigned long long.
+ */
+typedef size_t (*parse_t)(const char *text, unsigned long long *value);
+
+/*******************************************************************************
+ * TABLES
+ ******************************************************************************/
+
+/*
+ * The two-digit decimal representations of 0 through 99, back to back.
+ */
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/*
+ * Powers of ten, used to correct the digit count estimate.
+ */
+static const unsigned long long powers_of_ten[TIOC_UNSIGNED_MAX] =
+{
+    1ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL
+};
+
+/*******************************************************************************
+ * NUMBER FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Returns the number of decimal digits in value (1 for 0).
+ *
+ * The number of bits in value gives an estimate (log10(2) ~= 1233 / 4096)
+ * that is either exact or one too high, which a single table lookup fixes.
+ */
+static size_t count_digits(unsigned long long value);
+
+/*
+ * The scalar parse_t.
+ */
+static size_t parse_scalar(const char *text, unsigned long long *value);
+
+#ifdef TIOC_X86
+/*
+ * The SSE4.1 parse_t.
+ */
+static size_t parse_sse41(const char *text, unsigned long long *value);
+
+/*
+ * The AVX2 parse_t.  This only differs from the SSE4.1 version in finding the
+ * end of the digits with a single 32-byte compare.
+ */
+static size_t parse_avx2(const char *text, unsigned long long *value);
+
+/*
+ * Selects the fastest parse_t that the CPU supports.
+ */
+static void select_parser(void) __attribute__((constructor));
+#endif
+
+/*******************************************************************************
+ * PARSER SELECTION
+ ******************************************************************************/
+
+static parse_t parse = parse_scalar;
+
+#ifdef TIOC_X86
+static void select_parser(void)
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        parse = parse_avx2;
+    }
+    else if (__builtin_cpu_supports("sse4.1"))
+    {
+        parse = parse_sse41;
+    }
+}
+#endif
+
+/*******************************************************************************
+ * NUMBER FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+static size_t count_digits(unsigned long long value)
+{
+    unsigned bits, estimate;
+
+    /*
+     * Setting the low bit makes 0 count as one digit, and cannot change the
+     * result otherwise because every power of ten above 1 is even.
+     */
+    value |= 1;
+
+    bits = 64 - (unsigned)__builtin_clzll(value);
+    estimate = (bits * 1233) >> 12;
+
+    return estimate + 1 - (value < powers_of_ten[estimate]);
+}
+
+size_t tioc_format_unsigned(char *buffer, unsigned long long value)
+{
+    size_t len, i;
+    unsigned pair, small;
+
+    len = count_digits(value);
+    i = len;
+
+    /*
+     * Emit two digits per division, from the least significant end.  Above
+     * 32 bits the divisions are 64-bit, so peel those off first and finish in
+     * 32-bit arithmetic.
+     */
+    while (value >= 100000000ULL)
+    {
+        pair = (unsigned)(value % 100);
+        value /= 100;
+        i -= 2;
+        memcpy(buffer + i, digit_pairs + pair * 2, 2);
+    }
+
+    small = (unsigned)value;
+
+    while (small >= 100)
+    {
+        pair = small % 100;
+        small /= 100;
+        i -= 2;
+        memcpy(buffer + i, digit_pairs + pair * 2, 2);
+    }
+
+    if (small >= 10)
+    {
+        memcpy(buffer, digit_pairs + small * 2, 2);
+    }
+    else
+    {
+        buffer[0] = (char)('0' + small);
+    }
+
+    return len;
+}
+
+size_t tioc_parse_unsigned
+(
+    const char *text,
+    size_t size,
+    unsigned long long max,
+    unsigned long long *value
+)
+{
+    char padded[PARSE_WINDOW];
+    size_t len;
+    unsigned long long n;
+
+    /*
+     * Copy short inputs somewhere that the whole window can be read.  The
+     * padding is not a digit, and so ends the number.
+     */
+    if (size < PARSE_WINDOW)
+    {
+        memset(padded, 0, sizeof(padded));
+        memcpy(padded, text, size);
+        text = padded;
+    }
+
+    if (!(len = parse(text, &n)) || n > max) return 0;
+
+    *value = n;
+    return len;
+}
+
+size_t tioc_format_varint(char *buffer, unsigned long long value)
+{
+    size_t len = 0;
+
+    while (value >= 0x80)
+    {
+        buffer[len++] = (char)(value | 0x80);
+        value >>= 7;
+    }
+
+    buffer[len++] = (char)value;
+    return len;
+}
+
+size_t tioc_parse_varint
+(
+    const char *data,
+    size_t size,
+    unsigned long long *value
+)
+{
+    const unsigned char *p = (const unsigned char*)data;
+    unsigned long long n = 0;
+    size_t i;
+
+    if (size > TIOC_VARINT_MAX) size = TIOC_VARINT_MAX;
+
+    for (i = 0; i < size; ++i)
+    {
+        /*
+         * The tenth byte holds the top bit of the value, and nothing else.
+         */
+        if (i == TIOC_VARINT_MAX - 1 && p[i] > 1) return 0;
+
+        n |= (unsigned long long)(p[i] & 0x7f) << (7 * i);
+
+        if (!(p[i] & 0x80))
+        {
+            *value = n;
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+static size_t parse_scalar(const char *text, unsigned long long *value)
+{
+    size_t i;
+    unsigned digit;
+    unsigned long long n = 0;
+
+    /*
+     * Nineteen digits always fit, so only the twentieth needs checking.
+     */
+    for (i = 0; i < TIOC_UNSIGNED_MAX; ++i)
+    {
+        digit = (unsigned)(text[i] - '0');
+        if (digit > 9) break;
+
+        if (i == TIOC_UNSIGNED_MAX - 1 && n > (ULLONG_MAX - digit) / 10)
+            return 0;
+
+        n = n * 10 + digit;
+    }
+
+    if (i == TIOC_UNSIGNED_MAX && (unsigned)(text[i] - '0') <= 9) return 0;
+
+    *value = n;
+    return i;
+}
+
+#ifdef TIOC_X86
+/*
+ * The helpers below are always inlined, so that the AVX2 parser gets
+ * VEX-encoded copies of them and does not pay for switching between SSE and
+ * AVX state.
+ */
+
+/*
+ * Shuffle masks that move the first n bytes of a register to its end, and
+ * zero the rest, for n from 0 to 16.
+ */
+static const unsigned char align_right[17][16] =
+{
+#define R(n) \
+    { \
+         0 - (16 - n),  1 - (16 - n),  2 - (16 - n),  3 - (16 - n), \
+         4 - (16 - n),  5 - (16 - n),  6 - (16 - n),  7 - (16 - n), \
+         8 - (16 - n),  9 - (16 - n), 10 - (16 - n), 11 - (16 - n), \
+        12 - (16 - n), 13 - (16 - n), 14 - (16 - n), 15 - (16 - n) \
+    }
+    R(0), R(1), R(2), R(3), R(4), R(5), R(6), R(7), R(8),
+    R(9), R(10), R(11), R(12), R(13), R(14), R(15), R(16)
+#undef R
+};
+
+/*
+ * Returns a mask with bit i set if byte i of v is a decimal digit.
+ */
+__attribute__((target("sse4.1"), always_inline))
+static inline unsigned digit_mask_sse41(__m128i v)
+{
+    v = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    v = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(9)), v);
+
+    return (unsigned)_mm_movemask_epi8(v);
+}
+
+/*
+ * Converts 16 digits (as ASCII, with any leading zeros as 0 bytes rather than
+ * '0') into a value.
+ */
+__attribute__((target("sse4.1"), always_inline))
+static inline unsigned long long convert_sse41(__m128i v)
+{
+    v = _mm_maddubs_epi16
+        (
+            v,
+            _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1,
+                          10, 1, 10, 1, 10, 1, 10, 1)
+        );
+    v = _mm_madd_epi16(v, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    v = _mm_packus_epi32(v, v);
+    v = _mm_madd_epi16
+        (
+            v,
+            _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1)
+        );
+
+    return (unsigned long long)(unsigned)_mm_cvtsi128_si32(v) * 100000000ULL
+         + (unsigned)_mm_extract_epi32(v, 1);
+}
+
+/*
+ * Converts len digits at text, given that there are len (1 to 20) of them,
+ * and that the PARSE_WINDOW bytes at text are readable.
+ */
+__attribute__((target("sse4.1"), always_inline))
+static inline size_t finish_sse41
+(
+    const char *text,
+    size_t len,
+    unsigned long long *value
+)
+{
+    __m128i v;
+    size_t i;
+    unsigned long long high = 0, low;
+
+    if (len <= 16)
+    {
+        v = _mm_loadu_si128((const __m128i*)text);
+        v = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+        v = _mm_shuffle_epi8
+            (
+                v,
+                _mm_loadu_si128((const __m128i*)align_right[len])
+            );
+    }
+    else
+    {
+        for (i = 0; i < len - 16; ++i)
+        {
+            high = high * 10 + (unsigned)(text[i] - '0');
+        }
+
+        v = _mm_loadu_si128((const __m128i*)(text + len - 16));
+        v = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    }
+
+    low = convert_sse41(v);
+
+    if (high > HIGH_MAX || (high == HIGH_MAX && low > LOW_MAX)) return 0;
+
+    *value = high * 10000000000000000ULL + low;
+    return len;
+}
+
+__attribute__((target("sse4.1")))
+static size_t parse_sse41(const char *text, unsigned long long *value)
+{
+    unsigned mask;
+    size_t len;
+
+    mask = digit_mask_sse41(_mm_loadu_si128((const __m128i*)text));
+    if (0xffffU == mask)
+    {
+        mask |= digit_mask_sse41
+                (
+                    _mm_loadu_si128((const __m128i*)(text + 16))
+                ) << 16;
+    }
+
+    len = (size_t)__builtin_ctzll(~(unsigned long long)mask);
+    if (!len || len > TIOC_UNSIGNED_MAX) return 0;
+
+    return finish_sse41(text, len, value);
+}
+
+__attribute__((target("avx2")))
+static size_t parse_avx2(const char *text, unsigned long long *value)
+{
+    __m256i v;
+    unsigned mask;
+    size_t len;
+
+    v = _mm256_sub_epi8
+        (
+            _mm256_loadu_si256((const __m256i*)text),
+            _mm256_set1_epi8('0')
+        );
+    v = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(9)), v);
+    mask = (unsigned)_mm256_movemask_epi8(v);
+
+    len = (size_t)__builtin_ctzll(~(unsigned long long)mask);
+    if (!len || len > TIOC_UNSIGNED_MAX) return 0;
+
+    return finish_sse41(text, len, value);
+}
+#endif
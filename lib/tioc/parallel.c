@@ -0,0 +1,798 @@
+#define _GNU_SOURCE
+#include "tioc.h"
+#include "internal.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*******************************************************************************
+ * OVERVIEW
+ *
+ * Parses or checks a reader's data on several threads at once.
+ *
+ * The data is divided into chunks of roughly equal size, each of which starts
+ * at a record: the first field at or after its nominal start that has the
+ * label of the field at the reader's position.  Finding that field is not as
+ * simple as looking for "\n<label>:", as strings and blobs may contain exactly
+ * that, so each worker treats the first occurrence as a candidate, checks that
+ * the fields after it parse, and then walks field by field (skipping values by
+ * their lengths) to the record that starts the next chunk.
+ *
+ * A candidate inside a value may still parse for a while, so the main thread
+ * then follows the chain of walks from the reader's position, where the data
+ * is known to be at a field.  A chunk is correct if it starts where the walk
+ * of the one before it ended; a chunk that does not is walked again from
+ * there.  This is rare, and costs one chunk's walk on one thread.
+ *
+ * The chunks are then handed to the workers again, to be parsed through a
+ * reader of their own, and passed back in order as they complete.
+ *
+ * Verification needs no second pass: the walks check each field strictly as
+ * they go, so the first field of the chain that cannot be walked is the first
+ * bad one.
+ ******************************************************************************/
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/*
+ * The number of fields after a candidate that must parse for a worker to walk
+ * from it.
+ */
+#define PARALLEL_CHECK_FIELDS 16
+
+/*
+ * The number of chunks per thread that tioc_reader_verify() divides data into,
+ * so that threads that finish early have more to do.
+ */
+#define VERIFY_CHUNKS 4
+
+/*******************************************************************************
+ * TYPES
+ ******************************************************************************/
+
+struct parallel_chunk
+{
+    /*
+     * Where the chunk nominally starts, and where the next one does.
+     */
+    size_t nominal;
+    size_t target;
+
+    /*
+     * The data of the chunk, and whether the walk from start failed.
+     */
+    size_t start;
+    size_t end;
+    int failed;
+
+    /*
+     * Set, under the mutex, when a worker has finished with the chunk, along
+     * with what went wrong if it could not.
+     */
+    int done;
+    tioc_error_t error;
+};
+
+struct parallel
+{
+    const tioc_reader_t *reader;
+    const char *caller;
+
+    /*
+     * "\n<label>:", where the label is that of each record's first field.
+     */
+    char needle[TIOC_LABEL_MAX + 2];
+    size_t needle_length;
+
+    /*
+     * Set if walks check each field with tioc_reader_check_field() rather than
+     * just finding its end.
+     */
+    int strict;
+
+    struct parallel_chunk *chunks;
+    size_t count;
+
+    pthread_t *tids;
+    size_t threads;
+    size_t started;
+
+    /*
+     * What a worker does with each chunk, which returns what went wrong if it
+     * could not.
+     */
+    tioc_error_t (*run)(struct parallel *p, size_t i);
+
+    tioc_chunk_parser_t parse;
+    void *context;
+
+    /*
+     * The next chunk for a worker to take, and whether to stop taking them.
+     */
+    size_t next;
+    int stop;
+
+    int sync;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+
+/*******************************************************************************
+ * PARALLEL FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Prepares to divide the reader's data from its position into chunks, to be
+ * processed on threads threads.  p must have been zeroed, and must be passed
+ * to finish() whether or not this succeeds.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int init
+(
+    struct parallel *p,
+    const tioc_reader_t *reader,
+    size_t threads,
+    size_t chunks,
+    const char *caller
+);
+
+/*
+ * Finds where each chunk starts and ends.
+ *
+ * If broken is NULL, data that cannot be divided is a failure.  Otherwise, the
+ * chunks stop at the first field that cannot be walked, whose offset is stored
+ * in *broken (which is otherwise left alone).
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int divide(struct parallel *p, size_t *broken);
+
+/*
+ * Starts the workers running work.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int start_workers(struct parallel *p, void *(*work)(void *));
+
+/*
+ * Waits for the workers started by start_workers() to finish.
+ */
+static void join_workers(struct parallel *p);
+
+/*
+ * Waits for a worker to finish with chunk i.
+ *
+ * Returns -1 if it failed, 0 if it succeeded.
+ */
+static int wait_chunk(struct parallel *p, size_t i);
+
+/*
+ * Stops and waits for any workers, and frees what init() allocated.
+ */
+static void finish(struct parallel *p);
+
+/*
+ * Returns 1 if the field at pos is the first of a record, otherwise 0.
+ */
+static int is_record(const struct parallel *p, size_t pos);
+
+/*
+ * Walks from start, which must be at a field, to the first record at or after
+ * target, or to the end of the data, and sets *end to where it stopped (which,
+ * on failure, is the field that could not be walked).
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int walk
+(
+    const struct parallel *p,
+    size_t start,
+    size_t target,
+    size_t *end
+);
+
+/*
+ * Returns the first candidate record at or after nominal whose fields parse,
+ * or the size of the data if there is none.
+ */
+static size_t find_start(const struct parallel *p, size_t nominal);
+
+/*
+ * Finds the start and end of each chunk that a worker takes.
+ */
+static void *find_chunks(void *arg);
+
+/*
+ * Runs p->run on each chunk that a worker takes.
+ */
+static void *run_chunks(void *arg);
+
+/*
+ * Parses chunk i with p->parse.
+ */
+static tioc_error_t parse_chunk(struct parallel *p, size_t i);
+
+/*******************************************************************************
+ * PARALLEL FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+int tioc_reader_parse_parallel
+(
+    tioc_reader_t *reader,
+    size_t threads,
+    size_t chunks,
+    tioc_chunk_parser_t parse,
+    tioc_chunk_merger_t merge,
+    void *context
+)
+{
+    struct parallel p;
+    size_t i;
+    int result = -1;
+
+    memset(&p, 0, sizeof(p));
+
+    if (!reader)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_parse_parallel(): Invalid 'reader' argument."
+        );
+        goto cleanup;
+    }
+
+    if (!parse)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_parse_parallel(): Invalid 'parse' argument."
+        );
+        goto cleanup;
+    }
+
+    if (reader->binary || reader->group.active)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_parse_parallel(): "
+            "Not supported for binary data or within a group."
+        );
+        goto cleanup;
+    }
+
+    if (-1 == init(&p, reader, threads, chunks, "tioc_reader_parse_parallel"))
+    {
+        goto cleanup;
+    }
+
+    if (-1 == divide(&p, NULL)) goto cleanup;
+
+    /*
+     * Parse the chunks, merging each as soon as it and those before it are
+     * done.
+     */
+    p.run = parse_chunk;
+    p.parse = parse;
+    p.context = context;
+
+    if (-1 == start_workers(&p, run_chunks)) goto cleanup;
+
+    for (i = 0; i < p.count; ++i)
+    {
+        if (-1 == wait_chunk(&p, i)) goto cleanup;
+
+        if (merge && -1 == merge(i, context))
+        {
+            tioc_w
+            (
+                "tioc_reader_parse_parallel(): Unable to merge chunk %zu.",
+                i
+            );
+            goto cleanup;
+        }
+    }
+
+    reader->position = reader->size;
+    result = 0;
+
+cleanup:
+    finish(&p);
+    return result;
+}
+
+int tioc_reader_verify(tioc_reader_t *reader, size_t threads, size_t *offset)
+{
+    struct parallel p;
+    struct tioc_any_field field;
+    size_t pos, bad = SIZE_MAX;
+    long online;
+    int quiet, result = -1;
+
+    memset(&p, 0, sizeof(p));
+    if (offset) *offset = SIZE_MAX;
+
+    if (!reader)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_verify(): Invalid 'reader' argument."
+        );
+        goto cleanup;
+    }
+
+    if (reader->group.active)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_verify(): Not supported within a group."
+        );
+        goto cleanup;
+    }
+
+    /*
+     * Binary data defines its labels along the way, so it can only be checked
+     * in order.
+     */
+    if (reader->binary)
+    {
+        while (reader->position < reader->size)
+        {
+            if (-1 == tioc_reader_next_field(reader, &field))
+            {
+                if (offset) *offset = reader->position;
+                tioc_w
+                (
+                    "tioc_reader_verify(): Invalid field at offset %zu.",
+                    reader->position
+                );
+                goto cleanup;
+            }
+        }
+
+        result = 0;
+        goto cleanup;
+    }
+
+    /*
+     * The first field determines where records start, so it is checked before
+     * the data is divided.
+     */
+    if (reader->position < reader->size)
+    {
+        pos = reader->position;
+
+        quiet = tioc_set_quiet(1);
+        if (-1 == tioc_reader_check_field(reader, &pos)) bad = reader->position;
+        tioc_set_quiet(quiet);
+
+        if (SIZE_MAX != bad) goto report;
+    }
+
+    if (!threads)
+    {
+        online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t)online : 1;
+    }
+
+    if (-1 == init(&p, reader, threads, threads * VERIFY_CHUNKS,
+                   "tioc_reader_verify"))
+    {
+        goto cleanup;
+    }
+
+    p.strict = 1;
+    if (-1 == divide(&p, &bad)) goto cleanup;
+
+report:
+    /*
+     * Fields are checked quietly, so the first bad one is checked again here
+     * to report it.
+     */
+    if (SIZE_MAX != bad)
+    {
+        pos = bad;
+
+        if (-1 != tioc_reader_check_field(reader, &pos))
+        {
+            pos = bad;
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "tioc_reader_verify(): Invalid field at offset %zu.",
+                pos
+            );
+        }
+
+        if (offset) *offset = pos;
+        goto cleanup;
+    }
+
+    reader->position = reader->size;
+    result = 0;
+
+cleanup:
+    finish(&p);
+    return result;
+}
+
+static int init
+(
+    struct parallel *p,
+    const tioc_reader_t *reader,
+    size_t threads,
+    size_t chunks,
+    const char *caller
+)
+{
+    struct tioc_group_field first;
+    size_t i, pos, span;
+    long online;
+
+    p->reader = reader;
+    p->caller = caller;
+
+    if (!threads)
+    {
+        online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t)online : 1;
+    }
+
+    if (!chunks) chunks = threads;
+    if (threads > chunks) threads = chunks;
+
+    p->threads = threads;
+    p->count = chunks;
+
+    /*
+     * Every record starts with the label of the field at the position.
+     */
+    if (reader->position < reader->size)
+    {
+        pos = reader->position;
+
+        if (-1 == tioc_reader_scan_field(reader, &pos, &first))
+        {
+            tioc_w("%s(): Unable to read first field.", caller);
+            return -1;
+        }
+
+        if (memchr(reader->data + first.label, '\n', first.length))
+        {
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "%s(): Invalid label at offset %zu.",
+                caller,
+                first.label
+            );
+            return -1;
+        }
+
+        p->needle[0] = '\n';
+        memcpy(p->needle + 1, reader->data + first.label, first.length);
+        p->needle_length = first.length + 1;
+    }
+
+    if (!(p->chunks = calloc(chunks, sizeof(*p->chunks))) ||
+        !(p->tids = malloc(threads * sizeof(*p->tids))))
+    {
+        tioc_e(TIOC_ERROR_MEMORY, "%s(): malloc() failed.", caller);
+        return -1;
+    }
+
+    span = (reader->size - reader->position + chunks - 1) / chunks;
+
+    for (i = 0; i < chunks; ++i)
+    {
+        p->chunks[i].nominal = reader->position + i * span;
+        if (p->chunks[i].nominal > reader->size)
+        {
+            p->chunks[i].nominal = reader->size;
+        }
+
+        if (i) p->chunks[i - 1].target = p->chunks[i].nominal;
+    }
+
+    p->chunks[chunks - 1].target = reader->size;
+
+    if (pthread_mutex_init(&p->mutex, NULL))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_MEMORY,
+            "%s(): pthread_mutex_init() failed.",
+            caller
+        );
+        return -1;
+    }
+
+    if (pthread_cond_init(&p->cond, NULL))
+    {
+        pthread_mutex_destroy(&p->mutex);
+        tioc_e
+        (
+            TIOC_ERROR_MEMORY,
+            "%s(): pthread_cond_init() failed.",
+            caller
+        );
+        return -1;
+    }
+
+    p->sync = 1;
+    return 0;
+}
+
+static int divide(struct parallel *p, size_t *broken)
+{
+    struct parallel_chunk *chunk;
+    size_t i, start;
+    int quiet = 0, rc;
+
+    if (-1 == start_workers(p, find_chunks)) return -1;
+    join_workers(p);
+
+    /*
+     * Correct any chunk that starts somewhere other than where the chunk
+     * before it ends.
+     */
+    start = p->reader->position;
+
+    for (i = 0; i < p->count; ++i)
+    {
+        chunk = &p->chunks[i];
+
+        if (chunk->failed || chunk->start != start)
+        {
+            chunk->start = start;
+
+            if (broken) quiet = tioc_set_quiet(1);
+            rc = walk(p, start, chunk->target, &chunk->end);
+            if (broken) tioc_set_quiet(quiet);
+
+            if (-1 == rc)
+            {
+                if (!broken)
+                {
+                    tioc_w("%s(): Unable to divide data.", p->caller);
+                    return -1;
+                }
+
+                *broken = chunk->end;
+                p->count = i + 1;
+                break;
+            }
+        }
+
+        start = chunk->end;
+    }
+
+    return 0;
+}
+
+static int start_workers(struct parallel *p, void *(*work)(void *))
+{
+    p->next = 0;
+    p->stop = 0;
+
+    for (p->started = 0; p->started < p->threads; ++p->started)
+    {
+        if (pthread_create(&p->tids[p->started], NULL, work, p))
+        {
+            __atomic_store_n(&p->stop, 1, __ATOMIC_RELAXED);
+            join_workers(p);
+
+            tioc_e
+            (
+                TIOC_ERROR_MEMORY,
+                "%s(): pthread_create() failed.",
+                p->caller
+            );
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void join_workers(struct parallel *p)
+{
+    size_t i;
+
+    for (i = 0; i < p->started; ++i) pthread_join(p->tids[i], NULL);
+    p->started = 0;
+}
+
+static int wait_chunk(struct parallel *p, size_t i)
+{
+    struct parallel_chunk *chunk = &p->chunks[i];
+
+    pthread_mutex_lock(&p->mutex);
+    while (!chunk->done) pthread_cond_wait(&p->cond, &p->mutex);
+    pthread_mutex_unlock(&p->mutex);
+
+    if (chunk->error)
+    {
+        tioc_e
+        (
+            chunk->error,
+            "%s(): Unable to process chunk %zu.",
+            p->caller,
+            i
+        );
+        return -1;
+    }
+
+    return 0;
+}
+
+static void finish(struct parallel *p)
+{
+    __atomic_store_n(&p->stop, 1, __ATOMIC_RELAXED);
+    join_workers(p);
+
+    if (p->sync)
+    {
+        pthread_cond_destroy(&p->cond);
+        pthread_mutex_destroy(&p->mutex);
+    }
+
+    free(p->tids);
+    free(p->chunks);
+}
+
+static int is_record(const struct parallel *p, size_t pos)
+{
+    return p->needle_length - 1 <= p->reader->size - pos &&
+           !memcmp(p->reader->data + pos, p->needle + 1, p->needle_length - 1);
+}
+
+static int walk
+(
+    const struct parallel *p,
+    size_t start,
+    size_t target,
+    size_t *end
+)
+{
+    struct tioc_group_field field;
+    size_t pos = start, next;
+    int rc = 0;
+
+    while (pos < p->reader->size)
+    {
+        if (pos >= target && is_record(p, pos)) break;
+
+        next = pos;
+
+        if (p->strict) rc = tioc_reader_check_field(p->reader, &next);
+        else rc = tioc_reader_scan_field(p->reader, &next, &field);
+
+        if (-1 == rc) break;
+
+        pos = next;
+    }
+
+    *end = pos;
+    return rc;
+}
+
+static size_t find_start(const struct parallel *p, size_t nominal)
+{
+    const tioc_reader_t *reader = p->reader;
+    struct tioc_group_field field;
+    const char *match;
+    size_t from = nominal - 1, pos, i;
+
+    while (from < reader->size)
+    {
+        match = memmem
+                (
+                    reader->data + from,
+                    reader->size - from,
+                    p->needle,
+                    p->needle_length
+                );
+
+        if (!match) break;
+
+        pos = match + 1 - reader->data;
+
+        for (i = 0; i < PARALLEL_CHECK_FIELDS && pos < reader->size; ++i)
+        {
+            if (-1 == tioc_reader_scan_field(reader, &pos, &field)) break;
+        }
+
+        if (i == PARALLEL_CHECK_FIELDS || pos == reader->size)
+        {
+            return match + 1 - reader->data;
+        }
+
+        from = match + 1 - reader->data;
+    }
+
+    return reader->size;
+}
+
+static void *find_chunks(void *arg)
+{
+    struct parallel *p = arg;
+    struct parallel_chunk *chunk;
+    size_t i;
+
+    /*
+     * Candidates are expected to fail, and the main thread reports any failure
+     * that matters.
+     */
+    tioc_set_quiet(1);
+
+    while (!__atomic_load_n(&p->stop, __ATOMIC_RELAXED) &&
+           (i = __atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED)) < p->count)
+    {
+        chunk = &p->chunks[i];
+
+        chunk->start = i ? find_start(p, chunk->nominal) : p->reader->position;
+        chunk->failed = -1 == walk(p, chunk->start, chunk->target, &chunk->end);
+    }
+
+    return NULL;
+}
+
+static void *run_chunks(void *arg)
+{
+    struct parallel *p = arg;
+    tioc_error_t error;
+    size_t i;
+
+    while (!__atomic_load_n(&p->stop, __ATOMIC_RELAXED) &&
+           (i = __atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED)) < p->count)
+    {
+        error = p->run(p, i);
+
+        pthread_mutex_lock(&p->mutex);
+
+        p->chunks[i].error = error;
+        p->chunks[i].done = 1;
+        if (error) __atomic_store_n(&p->stop, 1, __ATOMIC_RELAXED);
+
+        pthread_cond_broadcast(&p->cond);
+        pthread_mutex_unlock(&p->mutex);
+    }
+
+    return NULL;
+}
+
+static tioc_error_t parse_chunk(struct parallel *p, size_t i)
+{
+    struct parallel_chunk *chunk = &p->chunks[i];
+    tioc_reader_t *reader;
+    tioc_error_t error = TIOC_ERROR_NONE;
+
+    reader = tioc_reader_open
+             (
+                 p->reader->data + chunk->start,
+                 chunk->end - chunk->start
+             );
+
+    if (!reader) return tioc_last_error();
+
+    reader->limit = p->reader->limit;
+
+    if (-1 == p->parse(reader, i, p->context))
+    {
+        error = tioc_last_error();
+        if (!error) error = TIOC_ERROR_ARGUMENT;
+    }
+
+    tioc_reader_close(reader);
+    return error;
+}
@@ -0,0 +1,2414 @@
+#include "tioc.h"
+#include "internal.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/*
+ * The number of slots that a group's hash table starts with.
+ */
+#define GROUP_MIN_SLOTS 32
+
+/*******************************************************************************
+ * GROUP FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Appends field to the current group, growing the fields array and the hash
+ * table as necessary.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int add_field(tioc_reader_t *reader, const struct tioc_group_field *field);
+
+/*******************************************************************************
+ * FIELD FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Checks that "<label>:" appears at the reader's position or, in group mode,
+ * looks the label up in the group.  For binary, checks that the next field has
+ * the label and kind given, or is a TIOC_KIND_RAW field, whose value the
+ * caller must then parse as text (as it would have been read before being
+ * transcoded).
+ *
+ * On success, *pos is set to the offset of the first byte of the value, and
+ * *end to the offset just past a raw value, or to 0 for any other.  The
+ * reader's position is not changed.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int begin_field
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    enum tioc_kind kind,
+    size_t *pos,
+    size_t *end,
+    const char *caller
+);
+
+/*
+ * Reads the binary tag at the reader's position, first processing any label
+ * definitions that precede it.
+ *
+ * On success, *tag is set to the tag, whose label is known to be defined, and
+ * *pos to the offset just past it.  The reader's position is not changed.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int read_tag
+(
+    tioc_reader_t *reader,
+    size_t *pos,
+    unsigned long long *tag,
+    const char *caller
+);
+
+/*
+ * Records the definition of a binary label id.  Definitions are processed
+ * again when a read fails and is retried, so redefining an id is allowed as
+ * long as the label is the same.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int define_label
+(
+    tioc_reader_t *reader,
+    unsigned long long id,
+    size_t offset,
+    size_t length,
+    const char *caller
+);
+
+/*
+ * Checks that a newline appears at pos (for text), or that the checksum at pos
+ * matches the field (for checked data), and moves the reader's position past
+ * it (unless the reader is in group mode).
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int end_field
+(
+    tioc_reader_t *reader,
+    size_t pos,
+    const char *caller
+);
+
+/*
+ * Checks that the checksum at pos matches the bytes from the reader's position
+ * up to pos.  This is inline, as it is called for every field of checked data.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static inline int check_sum
+(
+    const tioc_reader_t *reader,
+    size_t pos,
+    const char *caller
+);
+
+/*
+ * Parses "<label>:<length>:<payload>" (or its binary equivalent) at the
+ * reader's position.
+ *
+ * On success, *data and *size describe the payload within the reader's data
+ * and *pos is set to the offset just past it.  The reader's position is not
+ * changed.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int blob_field
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    const char **data,
+    size_t *size,
+    size_t *pos,
+    const char *caller
+);
+
+/*
+ * As blob_field(), but also checks that a text value is followed by a
+ * newline, or that a checked value matches its checksum, for callers that copy
+ * the value before calling end_field().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int string_field
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    const char **data,
+    size_t *size,
+    size_t *pos,
+    const char *caller
+);
+
+/*
+ * Reads a blob into memory from tioc_allocate(), with a terminator after it.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int copy_blob
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    char **data,
+    size_t *size,
+    const char *caller
+);
+
+/*
+ * As tioc_parse_varint() on the reader's data at pos, but with the common
+ * single-byte case inline.
+ */
+static inline size_t parse_varint
+(
+    const tioc_reader_t *reader,
+    size_t pos,
+    unsigned long long *value
+);
+
+/*
+ * As tioc_reader_next_field(), but for checked data, the field's checksum is
+ * only verified if verify is set.  Peeking and skipping do without, as the
+ * checksum covers the whole payload, and the field is verified by whatever
+ * reads it.
+ */
+static int next_field
+(
+    tioc_reader_t *reader,
+    struct tioc_any_field *field,
+    int verify
+);
+
+/*
+ * The text and binary halves of next_field().
+ */
+static int next_text(tioc_reader_t *reader, struct tioc_any_field *field);
+static int next_binary
+(
+    tioc_reader_t *reader,
+    struct tioc_any_field *field,
+    int verify
+);
+
+/*******************************************************************************
+ * CHECK FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Returns the number of bytes at the start of text, which is size bytes long,
+ * that could begin a UUID in its textual form (up to TIOC_UUID_LENGTH).
+ */
+static size_t match_uuid(const char *text, size_t size);
+
+/*******************************************************************************
+ * FIELD FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+static int begin_field
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    enum tioc_kind kind,
+    size_t *pos,
+    size_t *end,
+    const char *caller
+)
+{
+    size_t available, n;
+    const char *actual;
+    const struct tioc_group_field *field;
+    const struct tioc_definition *definition;
+    unsigned long long tag, length;
+
+    *end = 0;
+
+    if (!reader)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "%s(): Invalid 'reader' argument.", caller);
+        return -1;
+    }
+
+    if (!label)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "%s(): Invalid 'label' argument.", caller);
+        return -1;
+    }
+
+    if (reader->binary)
+    {
+        if (-1 == read_tag(reader, pos, &tag, caller)) return -1;
+
+        definition = &reader->definitions[tag >> TIOC_KIND_BITS];
+        actual = reader->data + definition->offset;
+
+        if (definition->length != label->length - 1 ||
+            memcmp(actual, label->prefix, definition->length))
+        {
+            tioc_e
+            (
+                TIOC_ERROR_LABEL,
+                "%s(): Expected '%s' but found '%.*s:'.",
+                caller,
+                label->prefix,
+                (int)definition->length,
+                actual
+            );
+            return -1;
+        }
+
+        if ((tag & ((1 << TIOC_KIND_BITS) - 1)) == TIOC_KIND_RAW)
+        {
+            if (!(n = parse_varint(reader, *pos, &length)) ||
+                length > reader->size - *pos - n)
+            {
+                tioc_e
+                (
+                    TIOC_ERROR_FORMAT,
+                    "%s(): Unable to read length.",
+                    caller
+                );
+                return -1;
+            }
+
+            *pos += n;
+            *end = *pos + (size_t)length;
+            return 0;
+        }
+
+        if ((tag & ((1 << TIOC_KIND_BITS) - 1)) != (unsigned)kind)
+        {
+            tioc_e
+            (
+                TIOC_ERROR_TYPE,
+                "%s(): Field '%.*s' has a different type.",
+                caller,
+                (int)definition->length,
+                actual
+            );
+            return -1;
+        }
+
+        return 0;
+    }
+
+    if (reader->group.active)
+    {
+        if (!(field = tioc_reader_find_field(reader, label->prefix,
+                        label->length, label->hash)))
+        {
+            tioc_e
+            (
+                TIOC_ERROR_LABEL,
+                "%s(): Label '%.*s' not found in group.",
+                caller,
+                (int)label->length - 1,
+                label->prefix
+            );
+            return -1;
+        }
+
+        *pos = field->value;
+        return 0;
+    }
+
+    actual = reader->data + reader->position;
+    available = reader->size - reader->position;
+
+    if (available < label->length)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_END,
+            "%s(): Unable to read label '%.*s'.",
+            caller,
+            (int)label->length - 1,
+            label->prefix
+        );
+        return -1;
+    }
+
+    if (memcmp(actual, label->prefix, label->length))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_LABEL,
+            "%s(): Expected '%s' but found '%.*s'.",
+            caller,
+            label->prefix,
+            (int)label->length,
+            actual
+        );
+        return -1;
+    }
+
+    *pos = reader->position + label->length;
+    return 0;
+}
+
+static int read_tag
+(
+    tioc_reader_t *reader,
+    size_t *pos,
+    unsigned long long *tag,
+    const char *caller
+)
+{
+    size_t p = reader->position, n;
+    unsigned long long length;
+
+    for (;;)
+    {
+        if (!(n = parse_varint(reader, p, tag)))
+        {
+            tioc_e
+            (
+                p < reader->size ? TIOC_ERROR_FORMAT : TIOC_ERROR_END,
+                "%s(): Unable to read tag at offset %zu.",
+                caller,
+                p
+            );
+            return -1;
+        }
+
+        p += n;
+
+        if (TIOC_KIND_DEFINE != (*tag & ((1 << TIOC_KIND_BITS) - 1))) break;
+
+        if (!(n = parse_varint(reader, p, &length)) ||
+            length > reader->size - p - n)
+        {
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "%s(): Unable to read label definition.",
+                caller
+            );
+            return -1;
+        }
+
+        p += n;
+
+        if (-1 == define_label(reader, *tag >> TIOC_KIND_BITS, p,
+                    (size_t)length, caller))
+        {
+            return -1;
+        }
+
+        p += (size_t)length;
+    }
+
+    if ((*tag & ((1 << TIOC_KIND_BITS) - 1)) > TIOC_KIND_RAW)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "%s(): Invalid tag at offset %zu.",
+            caller,
+            p - n
+        );
+        return -1;
+    }
+
+    if ((*tag >> TIOC_KIND_BITS) >= reader->definition_count)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "%s(): Undefined label at offset %zu.",
+            caller,
+            p - n
+        );
+        return -1;
+    }
+
+    *pos = p;
+    return 0;
+}
+
+static int define_label
+(
+    tioc_reader_t *reader,
+    unsigned long long id,
+    size_t offset,
+    size_t length,
+    const char *caller
+)
+{
+    struct tioc_definition *definitions, *d;
+    const char *label = reader->data + offset;
+
+    if (!length || length > TIOC_LABEL_MAX || memchr(label, ':', length) ||
+        memchr(label, '\n', length))
+    {
+        tioc_e(TIOC_ERROR_FORMAT, "%s(): Invalid label definition.", caller);
+        return -1;
+    }
+
+    if (id < reader->definition_count)
+    {
+        d = &reader->definitions[id];
+
+        if (d->length != length ||
+            memcmp(reader->data + d->offset, label, length))
+        {
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "%s(): Label %llu is defined twice.",
+                caller,
+                id
+            );
+            return -1;
+        }
+
+        return 0;
+    }
+
+    if (id != reader->definition_count)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "%s(): Label %llu is defined out of order.",
+            caller,
+            id
+        );
+        return -1;
+    }
+
+    if (reader->definition_count == reader->definition_capacity)
+    {
+        reader->definition_capacity = reader->definition_capacity
+                                    ? 2 * reader->definition_capacity
+                                    : 16;
+
+        definitions = realloc(reader->definitions,
+                reader->definition_capacity * sizeof(*definitions));
+        if (!definitions)
+        {
+            tioc_e(TIOC_ERROR_MEMORY, "%s(): realloc() failed.", caller);
+            return -1;
+        }
+
+        reader->definitions = definitions;
+    }
+
+    d = &reader->definitions[reader->definition_count++];
+    d->offset = offset;
+    d->length = length;
+
+    return 0;
+}
+
+static inline size_t parse_varint
+(
+    const tioc_reader_t *reader,
+    size_t pos,
+    unsigned long long *value
+)
+{
+    if (pos < reader->size && !(reader->data[pos] & 0x80))
+    {
+        *value = (unsigned char)reader->data[pos];
+        return 1;
+    }
+
+    return tioc_parse_varint(reader->data + pos, reader->size - pos, value);
+}
+
+static int end_field
+(
+    tioc_reader_t *reader,
+    size_t pos,
+    const char *caller
+)
+{
+    if (reader->checked)
+    {
+        if (pos != reader->verified && -1 == check_sum(reader, pos, caller))
+            return -1;
+
+        reader->verified = 0;
+        reader->position = pos + TIOC_CHECKSUM_LENGTH;
+        return 0;
+    }
+
+    if (reader->binary)
+    {
+        reader->position = pos;
+        return 0;
+    }
+
+    if (pos >= reader->size || '\n' != reader->data[pos])
+    {
+        tioc_e(TIOC_ERROR_FORMAT, "%s(): Missing newline.", caller);
+        return -1;
+    }
+
+    if (!reader->group.active) reader->position = pos + 1;
+    return 0;
+}
+
+static inline int check_sum
+(
+    const tioc_reader_t *reader,
+    size_t pos,
+    const char *caller
+)
+{
+    const unsigned char *stored = (const unsigned char*)reader->data + pos;
+    uint32_t crc;
+
+    if (reader->size - pos < TIOC_CHECKSUM_LENGTH)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_END,
+            "%s(): Missing checksum at offset %zu.",
+            caller,
+            pos
+        );
+        return -1;
+    }
+
+    crc = tioc_crc32c(0, reader->data + reader->position,
+            pos - reader->position);
+
+    if (crc != ((uint32_t)stored[0] | (uint32_t)stored[1] << 8 |
+                (uint32_t)stored[2] << 16 | (uint32_t)stored[3] << 24))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_CHECKSUM,
+            "%s(): Checksum mismatch for field at offset %zu.",
+            caller,
+            reader->position
+        );
+        return -1;
+    }
+
+    return 0;
+}
+
+static int blob_field
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    const char **data,
+    size_t *size,
+    size_t *pos,
+    const char *caller
+)
+{
+    size_t n, end, limit;
+    unsigned long long length;
+
+    if (-1 == begin_field(reader, label, TIOC_KIND_BLOB, pos, &end, caller))
+        return -1;
+
+    limit = end ? end : reader->size;
+
+    if (reader->binary && !end)
+    {
+        if (!(n = parse_varint(reader, *pos, &length)))
+        {
+            tioc_e(TIOC_ERROR_FORMAT, "%s(): Unable to read length.", caller);
+            return -1;
+        }
+
+        *pos += n;
+    }
+    else
+    {
+        n = tioc_parse_unsigned
+            (
+                reader->data + *pos,
+                limit - *pos,
+                SIZE_MAX - 1,
+                &length
+            );
+
+        if (!n)
+        {
+            tioc_e(TIOC_ERROR_FORMAT, "%s(): Unable to read length.", caller);
+            return -1;
+        }
+
+        *pos += n;
+
+        if (*pos >= limit || ':' != reader->data[*pos])
+        {
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "%s(): Missing colon after length.",
+                caller
+            );
+            return -1;
+        }
+
+        ++(*pos);
+    }
+
+    /*
+     * The length comes from the input, so check it against the limit and
+     * against what is actually there before anybody allocates memory for it.
+     */
+    if (length > reader->limit)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_LIMIT,
+            "%s(): Length %llu exceeds the limit of %zu.",
+            caller,
+            length,
+            reader->limit
+        );
+        return -1;
+    }
+
+    if (length > limit - *pos)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "%s(): Length %llu exceeds the remaining data.",
+            caller,
+            length
+        );
+        return -1;
+    }
+
+    /*
+     * A raw value must hold nothing after the payload, just as text must have
+     * its newline there.
+     */
+    if (end && length != end - *pos)
+    {
+        tioc_e(TIOC_ERROR_FORMAT, "%s(): Missing newline.", caller);
+        return -1;
+    }
+
+    *data = reader->data + *pos;
+    *size = (size_t)length;
+    *pos += (size_t)length;
+
+    return 0;
+}
+
+static int string_field
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    const char **data,
+    size_t *size,
+    size_t *pos,
+    const char *caller
+)
+{
+    if (-1 == blob_field(reader, label, data, size, pos, caller)) return -1;
+
+    if (reader->checked)
+    {
+        if (-1 == check_sum(reader, *pos, caller)) return -1;
+
+        reader->verified = *pos;
+        return 0;
+    }
+
+    if (!reader->binary && (*pos >= reader->size || '\n' != reader->data[*pos]))
+    {
+        tioc_e(TIOC_ERROR_FORMAT, "%s(): Missing newline.", caller);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * GROUP FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+int tioc_reader_scan_field
+(
+    const tioc_reader_t *reader,
+    size_t *pos,
+    struct tioc_group_field *field
+)
+{
+    const char *colon, *newline;
+    size_t p = *pos, n, available;
+    unsigned long long length;
+
+    available = reader->size - p;
+    if (available > TIOC_LABEL_MAX + 1) available = TIOC_LABEL_MAX + 1;
+
+    if (!(colon = memchr(reader->data + p, ':', available)) ||
+        colon == reader->data + p)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "tioc_reader_scan_field(): Unable to read label at offset %zu.",
+            p
+        );
+        return -1;
+    }
+
+    field->label = p;
+    field->length = colon - (reader->data + p) + 1;
+    field->hash = tioc_hash_label(reader->data + p, field->length);
+    field->value = p += field->length;
+
+    /*
+     * A run of digits followed by a colon is the length of a string or blob,
+     * which may itself contain newlines.  Anything else (an unsigned value or
+     * a UUID) runs up to the next newline.
+     */
+    n = tioc_parse_unsigned
+        (
+            reader->data + p,
+            reader->size - p,
+            SIZE_MAX - 1,
+            &length
+        );
+
+    if (n && p + n < reader->size && ':' == reader->data[p + n])
+    {
+        p += n + 1;
+
+        if (length > reader->size - p)
+        {
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "tioc_reader_scan_field(): "
+                "Length %llu exceeds the remaining data.",
+                length
+            );
+            return -1;
+        }
+
+        p += (size_t)length;
+    }
+    else
+    {
+        if (!(newline = memchr(reader->data + p, '\n', reader->size - p)))
+        {
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "tioc_reader_scan_field(): Missing newline."
+            );
+            return -1;
+        }
+
+        p = newline - reader->data;
+    }
+
+    if (p >= reader->size || '\n' != reader->data[p])
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "tioc_reader_scan_field(): Missing newline."
+        );
+        return -1;
+    }
+
+    *pos = p + 1;
+    return 0;
+}
+
+const struct tioc_group_field *tioc_reader_find_field
+(
+    const tioc_reader_t *reader,
+    const char *prefix,
+    size_t length,
+    unsigned int hash
+)
+{
+    const struct tioc_group *group = &reader->group;
+    const struct tioc_group_field *field;
+    size_t mask, i, slot;
+
+    if (!group->slot_count) return NULL;
+
+    mask = group->slot_count - 1;
+
+    for (i = hash & mask; (slot = group->slots[i]); i = (i + 1) & mask)
+    {
+        field = &group->fields[slot - 1];
+
+        if (hash == field->hash && length == field->length &&
+            !memcmp(prefix, reader->data + field->label, length))
+        {
+            return field;
+        }
+    }
+
+    return NULL;
+}
+
+static int add_field(tioc_reader_t *reader, const struct tioc_group_field *field)
+{
+    struct tioc_group *group = &reader->group;
+    struct tioc_group_field *fields;
+    size_t *slots, slot_count, mask, i, j;
+
+    if (group->count == group->capacity)
+    {
+        group->capacity = group->capacity ? 2 * group->capacity : 16;
+
+        fields = realloc(group->fields, group->capacity * sizeof(*fields));
+        if (!fields)
+        {
+            tioc_e(TIOC_ERROR_MEMORY, "add_field(): realloc() failed.");
+            return -1;
+        }
+
+        group->fields = fields;
+    }
+
+    group->fields[group->count++] = *field;
+
+    /*
+     * Keep the table at most half full, rebuilding it when it grows.
+     */
+    if (2 * group->count > group->slot_count)
+    {
+        slot_count = group->slot_count ? 2 * group->slot_count
+                                       : GROUP_MIN_SLOTS;
+
+        if (!(slots = calloc(slot_count, sizeof(*slots))))
+        {
+            tioc_e(TIOC_ERROR_MEMORY, "add_field(): calloc() failed.");
+            return -1;
+        }
+
+        free(group->slots);
+        group->slots = slots;
+        group->slot_count = slot_count;
+        j = 0;
+    }
+    else
+    {
+        j = group->count - 1;
+    }
+
+    mask = group->slot_count - 1;
+
+    for (; j < group->count; ++j)
+    {
+        i = group->fields[j].hash & mask;
+        while (group->slots[i]) i = (i + 1) & mask;
+
+        group->slots[i] = j + 1;
+    }
+
+    return 0;
+}
+
+int tioc_reader_begin_group(tioc_reader_t *reader, size_t count)
+{
+    struct tioc_group_field field;
+    size_t pos, scanned = 0;
+
+    if (!reader)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_begin_group(): Invalid 'reader' argument."
+        );
+        return -1;
+    }
+
+    if (reader->group.active)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_begin_group(): A group is already active."
+        );
+        return -1;
+    }
+
+    if (reader->binary)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_begin_group(): Binary data is not supported."
+        );
+        return -1;
+    }
+
+    reader->group.count = 0;
+    if (reader->group.slot_count)
+    {
+        memset(reader->group.slots, 0,
+                reader->group.slot_count * sizeof(*reader->group.slots));
+    }
+
+    pos = reader->position;
+
+    while (count ? scanned < count : pos < reader->size)
+    {
+        if (pos >= reader->size)
+        {
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "tioc_reader_begin_group(): Group ends after %zu fields.",
+                scanned
+            );
+            return -1;
+        }
+
+        if (-1 == tioc_reader_scan_field(reader, &pos, &field))
+        {
+            tioc_w("tioc_reader_begin_group(): Unable to scan field.");
+            return -1;
+        }
+
+        ++scanned;
+
+        if (tioc_reader_find_field(reader, reader->data + field.label, field.length,
+                    field.hash))
+        {
+            if (!count)
+            {
+                pos = field.label;
+                break;
+            }
+
+            continue;
+        }
+
+        if (-1 == add_field(reader, &field)) return -1;
+    }
+
+    reader->group.active = 1;
+    reader->group.end = pos;
+
+    return 0;
+}
+
+int tioc_reader_end_group(tioc_reader_t *reader)
+{
+    if (!reader || !reader->group.active)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_end_group(): No group is active."
+        );
+        return -1;
+    }
+
+    reader->group.active = 0;
+    reader->position = reader->group.end;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * CHECK FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+int tioc_reader_check_field(const tioc_reader_t *reader, size_t *pos)
+{
+    const char *data = reader->data;
+    size_t p = *pos, start = p, size = reader->size, digits, uuid, run;
+    unsigned long long length;
+    char c;
+
+    /*
+     * The label, and its colon.
+     */
+    for (; p < size && p - start < TIOC_LABEL_MAX; ++p)
+    {
+        c = data[p];
+        if ('_' != c && (c < 'a' || 'z' < c)) break;
+    }
+
+    if (p == size) goto end;
+
+    if (p == start || ':' != data[p])
+    {
+        *pos = p;
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "tioc_reader_check_field(): Invalid label at offset %zu.",
+            p
+        );
+        return -1;
+    }
+
+    start = ++p;
+
+    /*
+     * A length and its payload, a UUID, or an unsigned value.  A value that is
+     * none of them goes wrong where whichever of the last two it resembles
+     * more closely does.
+     */
+    digits = tioc_parse_unsigned(data + p, size - p, ULLONG_MAX, &length);
+
+    if (digits && p + digits < size && ':' == data[p + digits])
+    {
+        p += digits + 1;
+
+        if (length > size - p) goto end;
+        p += (size_t)length;
+    }
+    else if (TIOC_UUID_LENGTH == (uuid = match_uuid(data + p, size - p)))
+    {
+        p += uuid;
+    }
+    else
+    {
+        for (run = 0; p + run < size; ++run)
+        {
+            if (data[p + run] < '0' || '9' < data[p + run]) break;
+        }
+
+        if (uuid > run || !run)
+        {
+            p += uuid;
+            if (p == size) goto end;
+
+            *pos = p;
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "tioc_reader_check_field(): Invalid value at offset %zu.",
+                p
+            );
+            return -1;
+        }
+
+        if (run != digits)
+        {
+            *pos = start;
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "tioc_reader_check_field(): "
+                "Unsigned value out of range at offset %zu.",
+                start
+            );
+            return -1;
+        }
+
+        p += run;
+    }
+
+    if (p == size) goto end;
+
+    if ('\n' != data[p])
+    {
+        *pos = p;
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "tioc_reader_check_field(): Missing newline at offset %zu.",
+            p
+        );
+        return -1;
+    }
+
+    *pos = p + 1;
+    return 0;
+
+end:
+    *pos = size;
+    tioc_e
+    (
+        TIOC_ERROR_END,
+        "tioc_reader_check_field(): Field truncated at offset %zu.",
+        size
+    );
+    return -1;
+}
+
+static size_t match_uuid(const char *text, size_t size)
+{
+    size_t i;
+    char c;
+
+    if (size > TIOC_UUID_LENGTH) size = TIOC_UUID_LENGTH;
+
+    for (i = 0; i < size; ++i)
+    {
+        c = text[i];
+
+        if (8 == i || 13 == i || 18 == i || 23 == i)
+        {
+            if ('-' != c) break;
+        }
+        else if (!('0' <= c && c <= '9') && !('a' <= c && c <= 'f') &&
+                 !('A' <= c && c <= 'F'))
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/*******************************************************************************
+ * READER FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+tioc_reader_t *tioc_reader_open(const char *data, size_t size)
+{
+    tioc_reader_t *reader;
+
+    if (!data && size)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_open(): Invalid 'data' argument."
+        );
+        return NULL;
+    }
+
+    if (!(reader = malloc(sizeof(*reader))))
+    {
+        tioc_e(TIOC_ERROR_MEMORY, "tioc_reader_open(): malloc() failed.");
+        return NULL;
+    }
+
+    reader->data = data;
+    reader->size = size;
+    reader->position = 0;
+    reader->mapping = NULL;
+    reader->fd = -1;
+    reader->limit = SIZE_MAX - 1;
+    memset(&reader->group, 0, sizeof(reader->group));
+    reader->binary = 0;
+    reader->definitions = NULL;
+    reader->definition_count = 0;
+    reader->definition_capacity = 0;
+    reader->checked = 0;
+    reader->verified = 0;
+
+    if (size >= TIOC_BINARY_MAGIC_LENGTH &&
+        !memcmp(data, TIOC_BINARY_MAGIC, TIOC_BINARY_MAGIC_LENGTH))
+    {
+        reader->binary = 1;
+        reader->position = TIOC_BINARY_MAGIC_LENGTH;
+    }
+    else if (size >= TIOC_BINARY_MAGIC_LENGTH &&
+             !memcmp(data, TIOC_CHECKED_MAGIC, TIOC_BINARY_MAGIC_LENGTH))
+    {
+        reader->binary = 1;
+        reader->checked = 1;
+        reader->position = TIOC_BINARY_MAGIC_LENGTH;
+    }
+
+    return reader;
+}
+
+tioc_reader_t *tioc_reader_map(const char *filename)
+{
+    int fd = -1;
+    struct stat st;
+    void *mapping = NULL;
+    tioc_reader_t *reader = NULL;
+
+    if (!filename)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_map(): Invalid 'filename' argument."
+        );
+        goto cleanup;
+    }
+
+    if (-1 == (fd = open(filename, O_RDONLY)))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "tioc_reader_map(): Unable to open file '%s'.",
+            filename
+        );
+        goto cleanup;
+    }
+
+    if (-1 == fstat(fd, &st))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "tioc_reader_map(): Unable to stat file '%s'.",
+            filename
+        );
+        goto cleanup;
+    }
+
+    if ((unsigned long long)st.st_size > SIZE_MAX)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_LIMIT,
+            "tioc_reader_map(): File '%s' is too large.",
+            filename
+        );
+        goto cleanup;
+    }
+
+    /*
+     * Empty files cannot be mapped, but are perfectly good (empty) input.
+     */
+    if (st.st_size)
+    {
+        mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == mapping)
+        {
+            mapping = NULL;
+            tioc_e
+            (
+                TIOC_ERROR_IO,
+                "tioc_reader_map(): Unable to map file '%s'.",
+                filename
+            );
+            goto cleanup;
+        }
+
+        madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+    }
+
+    if (!(reader = tioc_reader_open(mapping, st.st_size))) goto cleanup;
+
+    reader->mapping = mapping;
+    mapping = NULL;
+
+    /*
+     * The descriptor is kept so that blobs can be copied from the file
+     * without going through the mapping.
+     */
+    reader->fd = fd;
+    fd = -1;
+
+cleanup:
+    if (mapping) munmap(mapping, st.st_size);
+    if (-1 != fd) close(fd);
+
+    return reader;
+}
+
+void tioc_reader_close(tioc_reader_t *reader)
+{
+    if (!reader) return;
+
+    if (reader->mapping) munmap(reader->mapping, reader->size);
+    if (-1 != reader->fd) close(reader->fd);
+    free(reader->group.fields);
+    free(reader->group.slots);
+    free(reader->definitions);
+    free(reader);
+}
+
+size_t tioc_reader_tell(const tioc_reader_t *reader)
+{
+    return reader->position;
+}
+
+int tioc_reader_eof(const tioc_reader_t *reader)
+{
+    return reader->position == reader->size;
+}
+
+void tioc_reader_set_limit(tioc_reader_t *reader, size_t max_size)
+{
+    if (!reader) return;
+
+    reader->limit = max_size && max_size < SIZE_MAX ? max_size : SIZE_MAX - 1;
+}
+
+tioc_encoding_t tioc_reader_encoding(const tioc_reader_t *reader)
+{
+    if (reader->checked) return TIOC_ENCODING_CHECKED;
+
+    return reader->binary ? TIOC_ENCODING_BINARY : TIOC_ENCODING_TEXT;
+}
+
+int tioc_reader_next_field(tioc_reader_t *reader, struct tioc_any_field *field)
+{
+    return next_field(reader, field, 1);
+}
+
+static int next_field
+(
+    tioc_reader_t *reader,
+    struct tioc_any_field *field,
+    int verify
+)
+{
+    if (!reader || !field)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_next_field(): Invalid argument."
+        );
+        return -1;
+    }
+
+    if (reader->group.active)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_next_field(): A group is active."
+        );
+        return -1;
+    }
+
+    return reader->binary ? next_binary(reader, field, verify)
+                          : next_text(reader, field);
+}
+
+static int next_text(tioc_reader_t *reader, struct tioc_any_field *field)
+{
+    struct tioc_group_field f;
+    const char *value;
+    char uuid_string[TIOC_UUID_LENGTH];
+    size_t pos = reader->position, size, n;
+    unsigned long long length;
+
+    if (-1 == tioc_reader_scan_field(reader, &pos, &f)) return -1;
+
+    field->label = reader->data + f.label;
+    field->length = f.length - 1;
+
+    /*
+     * The value runs up to the newline that tioc_reader_scan_field() found.
+     */
+    value = reader->data + f.value;
+    size = pos - 1 - f.value;
+
+    field->kind = TIOC_KIND_RAW;
+    field->data = value;
+    field->size = size;
+
+    n = tioc_parse_unsigned(value, size, SIZE_MAX - 1, &length);
+
+    if (n && n < size && ':' == value[n])
+    {
+        /*
+         * Only a length without leading zeros is one the writer produces.
+         */
+        if (1 == n || '0' != value[0])
+        {
+            field->kind = TIOC_KIND_BLOB;
+            field->data = value + n + 1;
+            field->size = (size_t)length;
+        }
+    }
+    else if ((n = tioc_parse_unsigned(value, size, ULLONG_MAX,
+                    &field->value)) && n == size && (1 == n || '0' != value[0]))
+    {
+        field->kind = TIOC_KIND_UNSIGNED;
+    }
+    else if (TIOC_UUID_LENGTH == size &&
+             0 == tioc_parse_uuid(value, field->uuid))
+    {
+        tioc_format_uuid(uuid_string, field->uuid);
+        if (!memcmp(uuid_string, value, TIOC_UUID_LENGTH))
+            field->kind = TIOC_KIND_UUID;
+    }
+
+    reader->position = pos;
+    return 0;
+}
+
+static int next_binary
+(
+    tioc_reader_t *reader,
+    struct tioc_any_field *field,
+    int verify
+)
+{
+    const struct tioc_definition *definition;
+    unsigned long long tag, length;
+    size_t pos, n;
+
+    if (-1 == read_tag(reader, &pos, &tag, "tioc_reader_next_field"))
+        return -1;
+
+    definition = &reader->definitions[tag >> TIOC_KIND_BITS];
+
+    field->label = reader->data + definition->offset;
+    field->length = definition->length;
+    field->kind = (enum tioc_kind)(tag & ((1 << TIOC_KIND_BITS) - 1));
+
+    switch (field->kind)
+    {
+        case TIOC_KIND_UNSIGNED:
+            if (!(n = parse_varint(reader, pos, &field->value)))
+            {
+                tioc_e
+                (
+                    TIOC_ERROR_FORMAT,
+                    "tioc_reader_next_field(): Unable to read value."
+                );
+                return -1;
+            }
+            pos += n;
+            break;
+
+        case TIOC_KIND_UUID:
+            if (reader->size - pos < sizeof(uuid_t))
+            {
+                tioc_e
+                (
+                    TIOC_ERROR_FORMAT,
+                    "tioc_reader_next_field(): Unable to read UUID."
+                );
+                return -1;
+            }
+            memcpy(field->uuid, reader->data + pos, sizeof(uuid_t));
+            pos += sizeof(uuid_t);
+            break;
+
+        default:
+            if (!(n = parse_varint(reader, pos, &length)) ||
+                length > reader->size - pos - n)
+            {
+                tioc_e
+                (
+                    TIOC_ERROR_FORMAT,
+                    "tioc_reader_next_field(): Unable to read length."
+                );
+                return -1;
+            }
+            field->data = reader->data + pos + n;
+            field->size = (size_t)length;
+            pos += n + (size_t)length;
+            break;
+    }
+
+    if (reader->checked)
+    {
+        if (verify)
+        {
+            if (-1 == check_sum(reader, pos, "tioc_reader_next_field"))
+                return -1;
+        }
+        else if (reader->size - pos < TIOC_CHECKSUM_LENGTH)
+        {
+            tioc_e
+            (
+                TIOC_ERROR_END,
+                "tioc_reader_next_field(): Missing checksum at offset %zu.",
+                pos
+            );
+            return -1;
+        }
+
+        pos += TIOC_CHECKSUM_LENGTH;
+    }
+
+    reader->position = pos;
+    return 0;
+}
+
+int tioc_reader_peek_label
+(
+    tioc_reader_t *reader,
+    const char **label,
+    size_t *length
+)
+{
+    struct tioc_any_field field;
+    size_t position;
+
+    if (!reader || !label || !length)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_peek_label(): Invalid argument."
+        );
+        return -1;
+    }
+
+    /*
+     * Reading binary may define labels along the way, but a definition that
+     * is read again is accepted, so only the position needs to be restored.
+     */
+    position = reader->position;
+    if (-1 == next_field(reader, &field, 0)) return -1;
+    reader->position = position;
+
+    *label = field.label;
+    *length = field.length;
+
+    return 0;
+}
+
+int tioc_reader_skip(tioc_reader_t *reader)
+{
+    struct tioc_any_field field;
+
+    return next_field(reader, &field, 0);
+}
+
+int tioc_reader_seek(tioc_reader_t *reader, size_t offset)
+{
+    if (!reader)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_seek(): Invalid 'reader' argument."
+        );
+        return -1;
+    }
+
+    if (reader->group.active)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "tioc_reader_seek(): A group is active.");
+        return -1;
+    }
+
+    if (offset > reader->size)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_seek(): Offset %zu is past the end.",
+            offset
+        );
+        return -1;
+    }
+
+    reader->position = offset;
+    return 0;
+}
+
+int tioc_reader_read_unsigned
+(
+    tioc_reader_t *reader,
+    const char *label,
+    unsigned long long *value
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_read_unsigned_l(reader, &l, value);
+}
+
+int tioc_reader_read_unsigned_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    unsigned long long *value
+)
+{
+    size_t pos, end, n;
+
+    if (!value)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_read_unsigned_l(): Invalid 'value' argument."
+        );
+        return -1;
+    }
+
+    if (-1 == begin_field(reader, label, TIOC_KIND_UNSIGNED, &pos, &end,
+                "tioc_reader_read_unsigned_l"))
+    {
+        return -1;
+    }
+
+    if (reader->binary && !end)
+    {
+        n = parse_varint(reader, pos, value);
+    }
+    else
+    {
+        n = tioc_parse_unsigned
+            (
+                reader->data + pos,
+                (end ? end : reader->size) - pos,
+                ULLONG_MAX,
+                value
+            );
+
+        if (end && pos + n != end)
+        {
+            tioc_e
+            (
+                TIOC_ERROR_FORMAT,
+                "tioc_reader_read_unsigned_l(): Missing newline."
+            );
+            return -1;
+        }
+    }
+
+    if (!n)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "tioc_reader_read_unsigned_l(): Unable to read unsigned value."
+        );
+        return -1;
+    }
+
+    return end_field(reader, pos + n, "tioc_reader_read_unsigned_l");
+}
+
+int tioc_reader_read_uuid
+(
+    tioc_reader_t *reader,
+    const char *label,
+    uuid_t uuid
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_read_uuid_l(reader, &l, uuid);
+}
+
+int tioc_reader_read_uuid_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    uuid_t uuid
+)
+{
+    size_t pos, end;
+
+    if (-1 == begin_field(reader, label, TIOC_KIND_UUID, &pos, &end,
+                "tioc_reader_read_uuid_l"))
+    {
+        return -1;
+    }
+
+    if (reader->binary && !end)
+    {
+        if (reader->size - pos < sizeof(uuid_t))
+        {
+            tioc_e
+            (
+                TIOC_ERROR_END,
+                "tioc_reader_read_uuid_l(): Unable to read UUID."
+            );
+            return -1;
+        }
+
+        memcpy(uuid, reader->data + pos, sizeof(uuid_t));
+        return end_field(reader, pos + sizeof(uuid_t),
+                "tioc_reader_read_uuid_l");
+    }
+
+    if ((end ? end : reader->size) - pos < TIOC_UUID_LENGTH ||
+        -1 == tioc_parse_uuid(reader->data + pos, uuid))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "tioc_reader_read_uuid_l(): Unable to parse UUID."
+        );
+        return -1;
+    }
+
+    if (end && pos + TIOC_UUID_LENGTH != end)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "tioc_reader_read_uuid_l(): Missing newline."
+        );
+        return -1;
+    }
+
+    return end_field(reader, pos + TIOC_UUID_LENGTH, "tioc_reader_read_uuid_l");
+}
+
+int tioc_reader_read_string
+(
+    tioc_reader_t *reader,
+    const char *label,
+    char **value
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_read_string_l(reader, &l, value);
+}
+
+int tioc_reader_read_string_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    char **value
+)
+{
+    size_t size;
+
+    return tioc_reader_read_blob_l(reader, label, value, &size);
+}
+
+int tioc_reader_read_blob
+(
+    tioc_reader_t *reader,
+    const char *label,
+    char **data,
+    size_t *size
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_read_blob_l(reader, &l, data, size);
+}
+
+int tioc_reader_read_blob_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    char **data,
+    size_t *size
+)
+{
+    return copy_blob(reader, label, NULL, data, size,
+            "tioc_reader_read_blob_l");
+}
+
+int tioc_reader_read_string_arena
+(
+    tioc_reader_t *reader,
+    const char *label,
+    tioc_arena_t *arena,
+    char **value
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_read_string_arena_l(reader, &l, arena, value);
+}
+
+int tioc_reader_read_string_arena_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    char **value
+)
+{
+    size_t size;
+
+    return copy_blob(reader, label, arena, value, &size,
+            "tioc_reader_read_string_arena_l");
+}
+
+int tioc_reader_read_blob_arena
+(
+    tioc_reader_t *reader,
+    const char *label,
+    tioc_arena_t *arena,
+    char **data,
+    size_t *size
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_read_blob_arena_l(reader, &l, arena, data, size);
+}
+
+int tioc_reader_read_blob_arena_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    char **data,
+    size_t *size
+)
+{
+    return copy_blob(reader, label, arena, data, size,
+            "tioc_reader_read_blob_arena_l");
+}
+
+int tioc_reader_read_string_into
+(
+    tioc_reader_t *reader,
+    const char *label,
+    char *buffer,
+    size_t capacity,
+    size_t *length
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_read_string_into_l(reader, &l, buffer, capacity, length);
+}
+
+int tioc_reader_read_string_into_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    char *buffer,
+    size_t capacity,
+    size_t *length
+)
+{
+    const char *payload;
+    size_t size, pos;
+
+    if (length) *length = 0;
+
+    if (!buffer || !capacity || !length)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_read_string_into_l(): Invalid argument."
+        );
+        return -1;
+    }
+
+    *buffer = 0;
+
+    if (-1 == string_field(reader, label, &payload, &size, &pos,
+                "tioc_reader_read_string_into_l"))
+    {
+        return -1;
+    }
+
+    *length = size;
+
+    /*
+     * The position has not moved, so the caller can try again with a buffer
+     * of *length + 1 bytes.
+     */
+    if (size >= capacity)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_CAPACITY,
+            "tioc_reader_read_string_into_l(): "
+            "String of %zu bytes does not fit in %zu.",
+            size,
+            capacity
+        );
+        return -1;
+    }
+
+    memcpy(buffer, payload, size);
+    buffer[size] = 0;
+
+    return end_field(reader, pos, "tioc_reader_read_string_into_l");
+}
+
+int tioc_reader_read_string_small
+(
+    tioc_reader_t *reader,
+    const char *label,
+    tioc_string_t *string
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_read_string_small_l(reader, &l, string);
+}
+
+int tioc_reader_read_string_small_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    tioc_string_t *string
+)
+{
+    const char *payload;
+    char *buffer;
+    size_t size, pos;
+
+    if (!string)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_read_string_small_l(): Invalid 'string' argument."
+        );
+        return -1;
+    }
+
+    string->length = 0;
+    string->buffer[0] = 0;
+
+    if (-1 == string_field(reader, label, &payload, &size, &pos,
+                "tioc_reader_read_string_small_l"))
+    {
+        return -1;
+    }
+
+    buffer = tioc_string_reserve(string, size,
+            "tioc_reader_read_string_small_l");
+    if (!buffer) return -1;
+
+    memcpy(buffer, payload, size);
+    buffer[size] = 0;
+    string->length = size;
+
+    return end_field(reader, pos, "tioc_reader_read_string_small_l");
+}
+
+static int copy_blob
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    char **data,
+    size_t *size,
+    const char *caller
+)
+{
+    const char *payload;
+    size_t pos;
+
+    if (data) *data = NULL;
+    if (size) *size = 0;
+
+    if (!data || !size)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "%s(): Invalid 'data' or 'size' argument.",
+            caller
+        );
+        return -1;
+    }
+
+    if (-1 == string_field(reader, label, &payload, size, &pos, caller))
+    {
+        *size = 0;
+        return -1;
+    }
+
+    if (!(*data = tioc_allocate(arena, *size + 1)))
+    {
+        tioc_e(TIOC_ERROR_MEMORY, "%s(): Unable to allocate memory.", caller);
+        *size = 0;
+        return -1;
+    }
+
+    memcpy(*data, payload, *size);
+    (*data)[*size] = 0;
+
+    return end_field(reader, pos, caller);
+}
+
+int tioc_reader_read_blob_to_fd
+(
+    tioc_reader_t *reader,
+    const char *label,
+    int fd,
+    size_t *size
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_read_blob_to_fd_l(reader, &l, fd, size);
+}
+
+int tioc_reader_read_blob_to_fd_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    int fd,
+    size_t *size
+)
+{
+    const char *payload;
+    size_t length, pos;
+
+    if (size) *size = 0;
+
+    if (-1 == string_field(reader, label, &payload, &length, &pos,
+                "tioc_reader_read_blob_to_fd_l"))
+    {
+        return -1;
+    }
+
+    if (-1 != reader->fd)
+    {
+        if (-1 == tioc_copy_range(reader->fd, payload - reader->data, fd,
+                    length, "tioc_reader_read_blob_to_fd_l"))
+        {
+            return -1;
+        }
+    }
+    else if (-1 == tioc_write_data(fd, payload, length))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "tioc_reader_read_blob_to_fd_l(): write() failed."
+        );
+        return -1;
+    }
+
+    if (size) *size = length;
+
+    return end_field(reader, pos, "tioc_reader_read_blob_to_fd_l");
+}
+
+int tioc_reader_read_string_view
+(
+    tioc_reader_t *reader,
+    const char *label,
+    tioc_view_t *view
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_read_string_view_l(reader, &l, view);
+}
+
+int tioc_reader_read_string_view_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    tioc_view_t *view
+)
+{
+    if (!view)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_read_string_view_l(): Invalid 'view' argument."
+        );
+        return -1;
+    }
+
+    return tioc_reader_read_blob_view_l(reader, label, view);
+}
+
+int tioc_reader_read_blob_view
+(
+    tioc_reader_t *reader,
+    const char *label,
+    tioc_view_t *view
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_read_blob_view_l(reader, &l, view);
+}
+
+int tioc_reader_read_blob_view_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    tioc_view_t *view
+)
+{
+    tioc_view_t v;
+    size_t pos;
+
+    if (!view)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_read_blob_view_l(): Invalid 'view' argument."
+        );
+        return -1;
+    }
+
+    if (-1 == blob_field(reader, label, &v.data, &v.size, &pos,
+                "tioc_reader_read_blob_view_l"))
+    {
+        return -1;
+    }
+
+    if (-1 == end_field(reader, pos, "tioc_reader_read_blob_view_l")) return -1;
+
+    *view = v;
+    return 0;
+}
+
+int tioc_reader_expect_unsigned
+(
+    tioc_reader_t *reader,
+    const char *label,
+    unsigned long long expected
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_expect_unsigned_l(reader, &l, expected);
+}
+
+int tioc_reader_expect_unsigned_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    unsigned long long expected
+)
+{
+    size_t position;
+    unsigned long long actual;
+
+    if (!reader)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_expect_unsigned_l(): Invalid 'reader' argument."
+        );
+        return -1;
+    }
+
+    position = reader->position;
+
+    if (-1 == tioc_reader_read_unsigned_l(reader, label, &actual)) return -1;
+
+    if (expected != actual)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_MISMATCH,
+            "tioc_reader_expect_unsigned_l(): Expected %llu but read %llu.",
+            expected,
+            actual
+        );
+        reader->position = position;
+        return -1;
+    }
+
+    return 0;
+}
+
+int tioc_reader_expect_uuid
+(
+    tioc_reader_t *reader,
+    const char *label,
+    uuid_t expected
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_expect_uuid_l(reader, &l, expected);
+}
+
+int tioc_reader_expect_uuid_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    uuid_t expected
+)
+{
+    size_t position;
+    uuid_t actual;
+    char expected_str[37];
+
+    if (!reader)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_expect_uuid_l(): Invalid 'reader' argument."
+        );
+        return -1;
+    }
+
+    position = reader->position;
+
+    if (-1 == tioc_reader_read_uuid_l(reader, label, actual)) return -1;
+
+    if (memcmp(expected, actual, sizeof(uuid_t)))
+    {
+        tioc_format_uuid(expected_str, expected);
+        expected_str[TIOC_UUID_LENGTH] = 0;
+        tioc_e
+        (
+            TIOC_ERROR_MISMATCH,
+            "tioc_reader_expect_uuid_l(): Expected UUID '%s' not found.",
+            expected_str
+        );
+        reader->position = position;
+        return -1;
+    }
+
+    return 0;
+}
+
+int tioc_reader_expect_string
+(
+    tioc_reader_t *reader,
+    const char *label,
+    const char *expected
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_reader_expect_string_l(reader, &l, expected);
+}
+
+int tioc_reader_expect_string_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    const char *expected
+)
+{
+    const char *actual;
+    size_t size, pos;
+
+    if (!expected)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_expect_string_l(): Invalid 'expected' argument."
+        );
+        return -1;
+    }
+
+    /*
+     * The value is checked before it is compared, so that a corrupted one is
+     * reported as such rather than as a mismatch.
+     */
+    if (-1 == string_field(reader, label, &actual, &size, &pos,
+                "tioc_reader_expect_string_l"))
+    {
+        return -1;
+    }
+
+    if (strlen(expected) != size || memcmp(expected, actual, size))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_MISMATCH,
+            "tioc_reader_expect_string_l(): Expected '%s' but found '%.*s'.",
+            expected,
+            (int)size,
+            actual
+        );
+        return -1;
+    }
+
+    return end_field(reader, pos, "tioc_reader_expect_string_l");
+}
+
+int tioc_reader_read_record
+(
+    tioc_reader_t *reader,
+    const tioc_schema_t *schema,
+    void *record
+)
+{
+    const struct tioc_schema_field *field;
+    char *value;
+    size_t i, position;
+    int rc = 0;
+
+    if (!reader || !schema || !record)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_reader_read_record(): Invalid argument."
+        );
+        return -1;
+    }
+
+    position = reader->position;
+
+    for (i = 0; 0 == rc && i < schema->count; ++i)
+    {
+        field = &schema->fields[i];
+        value = (char*)record + field->offset;
+
+        switch (field->type)
+        {
+            case TIOC_TYPE_UNSIGNED:
+                rc = tioc_reader_read_unsigned_l(reader, &field->label,
+                        (unsigned long long*)value);
+                break;
+
+            case TIOC_TYPE_UUID:
+                rc = tioc_reader_read_uuid_l(reader, &field->label,
+                        (unsigned char*)value);
+                break;
+
+            case TIOC_TYPE_STRING:
+                rc = tioc_reader_read_string_l(reader, &field->label,
+                        (char**)value);
+                break;
+
+            case TIOC_TYPE_BLOB:
+                rc = tioc_reader_read_blob_l(reader, &field->label,
+                        (char**)value,
+                        (size_t*)((char*)record + field->size_offset));
+                break;
+        }
+    }
+
+    if (rc)
+    {
+        /*
+         * The field that failed has already cleaned up after itself.
+         */
+        tioc_free_fields(schema, record, i - 1);
+        reader->position = position;
+    }
+
+    return rc;
+}
@@ -0,0 +1,122 @@
+#include "tioc.h"
+#include "internal.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+/*******************************************************************************
+ * OVERVIEW
+ *
+ * Compilation of record schemas.  The record functions themselves live with
+ * the FILE, tioc_writer_t and tioc_reader_t functions that they build on.
+ ******************************************************************************/
+
+/*******************************************************************************
+ * SCHEMA FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+tioc_schema_t *tioc_schema_compile(const tioc_field_t *fields, size_t count)
+{
+    tioc_schema_t *schema;
+    struct tioc_schema_field *field;
+    size_t i;
+
+    if (!fields && count)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_schema_compile(): Invalid 'fields' argument."
+        );
+        return NULL;
+    }
+
+    if (count > (SIZE_MAX - sizeof(*schema)) / sizeof(*field))
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "tioc_schema_compile(): Too many fields.");
+        return NULL;
+    }
+
+    if (!(schema = malloc(sizeof(*schema) + count * sizeof(*field))))
+    {
+        tioc_e(TIOC_ERROR_MEMORY, "tioc_schema_compile(): malloc() failed.");
+        return NULL;
+    }
+
+    schema->count = count;
+
+    for (i = 0; i < count; ++i)
+    {
+        field = &schema->fields[i];
+
+        if (-1 == tioc_label_init(&field->label, fields[i].label))
+        {
+            tioc_e
+            (
+                TIOC_ERROR_ARGUMENT,
+                "tioc_schema_compile(): Invalid label in field %zu.",
+                i
+            );
+            free(schema);
+            return NULL;
+        }
+
+        switch (fields[i].type)
+        {
+            case TIOC_TYPE_UNSIGNED:
+            case TIOC_TYPE_UUID:
+            case TIOC_TYPE_STRING:
+            case TIOC_TYPE_BLOB:
+                break;
+
+            default:
+                tioc_e
+                (
+                    TIOC_ERROR_ARGUMENT,
+                    "tioc_schema_compile(): Invalid type in field %zu.",
+                    i
+                );
+                free(schema);
+                return NULL;
+        }
+
+        field->type = fields[i].type;
+        field->offset = fields[i].offset;
+        field->size_offset = fields[i].size_offset;
+    }
+
+    return schema;
+}
+
+void tioc_schema_free(tioc_schema_t *schema)
+{
+    free(schema);
+}
+
+void tioc_free_record(const tioc_schema_t *schema, void *record)
+{
+    if (!schema || !record) return;
+
+    tioc_free_fields(schema, record, schema->count);
+}
+
+void tioc_free_fields(const tioc_schema_t *schema, void *record, size_t count)
+{
+    const struct tioc_schema_field *field;
+    char **data;
+    size_t i;
+
+    for (i = 0; i < count; ++i)
+    {
+        field = &schema->fields[i];
+
+        if (TIOC_TYPE_STRING != field->type && TIOC_TYPE_BLOB != field->type)
+            continue;
+
+        data = (char**)((char*)record + field->offset);
+        free(*data);
+        *data = NULL;
+
+        if (TIOC_TYPE_BLOB == field->type)
+            *(size_t*)((char*)record + field->size_offset) = 0;
+    }
+}
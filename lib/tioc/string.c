@@ -0,0 +1,57 @@
+#include "tioc.h"
+#include "internal.h"
+#include <stdlib.h>
+
+/*******************************************************************************
+ * SMALL STRING FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+void tioc_string_init(tioc_string_t *string)
+{
+    if (!string) return;
+
+    string->length = 0;
+    string->heap = NULL;
+    string->capacity = 0;
+    string->buffer[0] = 0;
+}
+
+const char *tioc_string_data(const tioc_string_t *string)
+{
+    if (string->length < TIOC_STRING_INLINE) return string->buffer;
+
+    return string->heap;
+}
+
+void tioc_string_free(tioc_string_t *string)
+{
+    if (!string) return;
+
+    free(string->heap);
+    tioc_string_init(string);
+}
+
+char *tioc_string_reserve
+(
+    tioc_string_t *string,
+    size_t length,
+    const char *caller
+)
+{
+    char *heap;
+
+    if (length < TIOC_STRING_INLINE) return string->buffer;
+    if (length < string->capacity) return string->heap;
+
+    if (!(heap = malloc(length + 1)))
+    {
+        tioc_e(TIOC_ERROR_MEMORY, "%s(): Unable to allocate string.", caller);
+        return NULL;
+    }
+
+    free(string->heap);
+    string->heap = heap;
+    string->capacity = length + 1;
+
+    return heap;
+}
@@ -1,9 +1,12 @@
 #include "tioc.h"
+#include "internal.h"
 #include <stdlib.h>
-#include <locale.h>
+#include <limits.h>
 #include <uuid/uuid.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <unistd.h>
 
 /*******************************************************************************
  * TYPES
@@ -22,30 +25,87 @@ struct rblob
 {
     char **data;
     size_t *size;
+    tioc_arena_t *arena;
+    const tioc_read_limits_t *limits;
 };
 
+/*
+ * The destination of string_into_reader(): either buffer, which is capacity
+ * bytes long, or string, if it is set.
+ */
+struct rstring
+{
+    char *buffer;
+    size_t capacity;
+    size_t *length;
+    tioc_string_t *string;
+};
+
+struct wblob_fd
+{
+    int fd;
+    size_t size;
+};
+
+struct rblob_fd
+{
+    int fd;
+    size_t *size;
+};
+
+/*******************************************************************************
+ * LIMITS
+ ******************************************************************************/
+
+/*
+ * Set by tioc_set_read_limits(), and only accessed atomically.
+ */
+static size_t read_max_size = SIZE_MAX - 1;
+static size_t read_grow_threshold = TIOC_GROW_THRESHOLD;
+
 /*******************************************************************************
- * WARNING FUNCTTIOCN DECLARATIONS
+ * NUMBER FUNCTION DECLARATIONS
  ******************************************************************************/
 
 /*
- * Prints a warning message to standard error.
+ * Writes an unsigned value to the file in decimal, using
+ * tioc_format_unsigned().
+ *
+ * The caller must hold the lock on file (see flockfile()).
+ *
+ * Returns -1 on failure, 0 on success.
  */
-static void w(const char *fmt, ...);
+static int put_unsigned(FILE *file, unsigned long long value);
 
 /*
- * Prints a warning message to standard error, using the arguments supplied.
+ * Reads a decimal unsigned value from the file.
+ *
+ * Between 1 and TIOC_UNSIGNED_MAX digits must be present, and the value must
+ * not exceed max.  The character following the digits is pushed back onto the
+ * stream.  Like put_unsigned(), this is locale-independent and the caller
+ * must hold the lock on file.
+ *
+ * Returns -1 on failure, 0 on success.
  */
-static void wv(const char *fmt, va_list args);
+static int get_unsigned
+(
+    FILE *file,
+    unsigned long long max,
+    unsigned long long *value
+);
 
-/*******************************************************************************
- * LABEL FUNCTION DECLARATIONS
- ******************************************************************************/
+/*
+ * Reads a single character from the file, and checks that it is expected.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int get_char(FILE *file, char expected);
 
 /*
- * Returns 1 if the label is valid, otherwise 0.
+ * Returns the error for a read from file that came up short:
+ * TIOC_ERROR_END at the end of the file, otherwise TIOC_ERROR_IO.
  */
-static int is_label_valid(const char *label);
+static tioc_error_t file_error(FILE *file);
 
 /*******************************************************************************
  * WRITE FUNCTION DECLARATIONS
@@ -55,17 +115,18 @@ static int is_label_valid(const char *label);
  * The write_callback function performs the operations common to all write_xxx()
  * functions.
  *
- * E.g., it checks that file and label are valid, sets the locale to "C" and
- * restores the locale afterwards.
+ * E.g., it checks that file and label are valid, and holds the lock on file
+ * for the whole record so that records written concurrently to the same file
+ * are not interleaved.
  *
  * The actually writing of the data is performed by the callback.
  */
 static int write_callback
 (
     FILE *file,
-    const char *label,
+    const tioc_label_t *label,
     write_callback_t callback,
-    void *data
+    const void *data
 );
 
 /*
@@ -85,18 +146,25 @@ static int uuid_writer(FILE *file, const void *data);
  */
 static int blob_writer(FILE *file, const void *data);
 
+/*
+ * This is the callback used for writing blobs from a file descriptor.
+ *
+ * The data argument should be a struct wblob_fd.
+ */
+static int blob_fd_writer(FILE *file, const void *data);
+
 /*******************************************************************************
  * READ FUNCTION DECLARATIONS
  ******************************************************************************/
 
 /*
- * This function does the common reading tasks, like resetting the locale to
- * the "C" locale, etc, before calling the callback.
+ * This function does the common reading tasks, like locking the file and
+ * reading the label, before calling the callback.
  */
 static int read_callback
 (
     FILE *file,
-    const char *label,
+    const tioc_label_t *label,
     read_callback_t callback,
     void *data
 );
@@ -113,58 +181,120 @@ static int uuid_reader
     void *data
 );
 
+/*
+ * Sets *max_size and *grow_threshold from limits or, if it is NULL, from
+ * those set by tioc_set_read_limits().  *max_size is never more than
+ * SIZE_MAX - 1, so that a terminator can always be added.
+ */
+static void get_limits
+(
+    const tioc_read_limits_t *limits,
+    size_t *max_size,
+    size_t *grow_threshold
+);
+
+/*
+ * Reads a string or blob payload of length bytes into memory from
+ * tioc_allocate(), with a terminator after it, subject to the limits given
+ * (see get_limits()).
+ *
+ * Returns -1 on failure (with *data set to NULL), 0 on success.
+ */
+static int get_payload
+(
+    FILE *file,
+    unsigned long long length,
+    tioc_arena_t *arena,
+    const tioc_read_limits_t *limits,
+    char **data,
+    const char *caller
+);
+
+/*
+ * The data argument should be a struct rblob, whose size is not used.
+ */
 static int string_reader
 (
     FILE *file,
     void *data
 );
 
+/*
+ * The data argument should be a struct rstring.
+ */
+static int string_into_reader
+(
+    FILE *file,
+    void *data
+);
+
+/*
+ * The data argument should be a struct rblob.
+ */
 static int blob_reader
 (
     FILE *file,
     void *data
 );
 
+/*
+ * The data argument should be a struct rblob_fd.
+ */
+static int blob_fd_reader
+(
+    FILE *file,
+    void *data
+);
+
 /*******************************************************************************
- * EXPECT FUNCTION DECLARATIONS
+ * SCAN FUNCTION DECLARATIONS
  ******************************************************************************/
 
 /*
- * Reads a label from file.
+ * Reads characters from file up to the colon after a label, storing them in
+ * label (which must have room for TIOC_LABEL_MAX + 1 bytes) and setting
+ * *length to how many there are.  *next is set to the character that ended
+ * the label (a colon if it is valid), or EOF.
  *
- * Returns -1 if something went wrong, or 0 if the label was read.
+ * The caller must hold the lock on file.
+ *
+ * Returns -1 if the characters are not a label followed by a colon, 0 if they
+ * are.  Either way, nothing is reported.
  */
-static int expect_label
+static int get_label(FILE *file, char *label, size_t *length, int *next);
+
+/*
+ * Moves file past length bytes, with fseeko() if it can, or by reading them.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int skip_payload
 (
     FILE *file,
-    const char *expected
+    unsigned long long length,
+    const char *caller
 );
 
 /*******************************************************************************
- * WARNING FUNCTION DECLARATIONS
+ * EXPECT FUNCTION DECLARATIONS
  ******************************************************************************/
 
-static void w(const char *fmt, ...)
-{
-    va_list args;
-
-    va_start(args, fmt);
-    wv(fmt, args);
-    va_end(args);
-}
-
-static void wv(const char *fmt, va_list args)
-{
-    fprintf(stderr, "libtioc: ");
-    vfprintf(stderr, fmt, args);
-    fprintf(stderr, "\n");
-}
+/*
+ * Reads a label, and the colon that follows it, from file.
+ *
+ * Returns -1 if something went wrong, or 0 if the label was read.
+ */
+static int expect_label
+(
+    FILE *file,
+    const tioc_label_t *expected
+);
 
 /*******************************************************************************
  * LABEL FUNCTION DEFINITIONS
  ******************************************************************************/
 
-static int is_label_valid(const char *label)
+int tioc_is_label_valid(const char *label)
 {
     size_t i, len;
     char c;
@@ -172,7 +302,7 @@ static int is_label_valid(const char *label)
     if (!label) return 0;
 
     len = strlen(label);
-    if (!len || len > 80) return 0;
+    if (!len || len > TIOC_LABEL_MAX) return 0;
 
     for (i = 0; i < len; ++i)
     {
@@ -183,95 +313,230 @@ static int is_label_valid(const char *label)
     return 1;
 }
 
+int tioc_label_init(tioc_label_t *label, const char *name)
+{
+    size_t len;
+
+    if (!label)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_label_init(): Invalid 'label' argument."
+        );
+        return -1;
+    }
+
+    if (!tioc_is_label_valid(name))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_label_init(): Invalid label '%s'.",
+            name ? name : ""
+        );
+        return -1;
+    }
+
+    len = strlen(name);
+
+    memcpy(label->prefix, name, len);
+    label->prefix[len] = ':';
+    label->prefix[len + 1] = 0;
+    label->length = len + 1;
+    label->hash = tioc_hash_label(label->prefix, label->length);
+
+    return 0;
+}
+
+int tioc_label_set(tioc_label_t *label, const char *name, size_t length)
+{
+    if (!length || length > TIOC_LABEL_MAX || memchr(name, ':', length) ||
+        memchr(name, '\n', length))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "tioc_label_set(): Invalid label '%.*s'.",
+            (int)length,
+            name
+        );
+        return -1;
+    }
+
+    memcpy(label->prefix, name, length);
+    label->prefix[length] = ':';
+    label->prefix[length + 1] = 0;
+    label->length = length + 1;
+    label->hash = tioc_hash_label(label->prefix, label->length);
+
+    return 0;
+}
+
+unsigned int tioc_hash_label(const char *prefix, size_t length)
+{
+    unsigned int hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < length; ++i)
+    {
+        hash ^= (unsigned char)prefix[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
 /*******************************************************************************
- * WRITE FUNCTION DEFINITIONS
+ * NUMBER FUNCTION DEFINITIONS
  ******************************************************************************/
 
-static int write_callback
+static int put_unsigned(FILE *file, unsigned long long value)
+{
+    char digits[TIOC_UNSIGNED_MAX];
+    size_t len;
+
+    len = tioc_format_unsigned(digits, value);
+    if (1 != fwrite(digits, len, 1, file)) return -1;
+
+    return 0;
+}
+
+static int get_unsigned
 (
     FILE *file,
-    const char *label,
-    write_callback_t callback,
-    void *data
+    unsigned long long max,
+    unsigned long long *value
 )
 {
-    int rc = -1;
-    int crc = -1;
-    char *old_locale = NULL;
-    char *old_locale2 = NULL;
+    int c;
+    char digits[TIOC_UNSIGNED_MAX + 1];
+    size_t count = 0;
 
-    if (!file)
+    /*
+     * Collect the digits (and at most one too many, which is an error), then
+     * hand them to the same parser used for in-memory data.
+     */
+    while (count < sizeof(digits) &&
+           EOF != (c = getc_unlocked(file)) && '0' <= c && c <= '9')
     {
-        w("write_callback(): Invalid 'file' argument.");
-        goto cleanup;
+        digits[count++] = (char)c;
     }
 
-    if (!label)
+    if (count < sizeof(digits) && EOF != c) ungetc(c, file);
+
+    if (!count)
     {
-        w("write_callback(): Invalid 'label' argument.");
-        goto cleanup;
+        tioc_e(TIOC_ERROR_FORMAT, "get_unsigned(): No digits found.");
+        return -1;
     }
 
-    if (!callback)
+    if (count != tioc_parse_unsigned(digits, count, max, value))
     {
-        w("write_callback(): Invalid 'callback' argument.");
-        goto cleanup;
+        tioc_e(TIOC_ERROR_FORMAT, "get_unsigned(): Value out of range.");
+        return -1;
     }
 
-    if (!data)
+    return 0;
+}
+
+static tioc_error_t file_error(FILE *file)
+{
+    return feof(file) ? TIOC_ERROR_END : TIOC_ERROR_IO;
+}
+
+static int get_char(FILE *file, char expected)
+{
+    int c;
+
+    if (EOF == (c = getc_unlocked(file)))
     {
-        w("write_callback(): Invalid 'data' argument.");
-        goto cleanup;
+        tioc_e(file_error(file), "get_char(): Unable to read character.");
+        return -1;
     }
 
-    if (!is_label_valid(label)) 
+    if (c != (unsigned char)expected) return -1;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * WRITE FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+static int write_callback
+(
+    FILE *file,
+    const tioc_label_t *label,
+    write_callback_t callback,
+    const void *data
+)
+{
+    int rc = -1;
+    int crc = -1;
+    int locked = 0;
+
+    if (!file)
     {
-        w("write_callback(): Invalid label '%s'.", label);
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "write_callback(): Invalid 'file' argument."
+        );
         goto cleanup;
     }
 
-    if (!(old_locale = setlocale(LC_ALL, NULL)))
+    if (!label)
     {
-        w("write_callback(): setlocale(LC_ALL, NULL) failed.");
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "write_callback(): Invalid 'label' argument."
+        );
         goto cleanup;
     }
 
-    if (!(old_locale2 = strdup(old_locale)))
+    if (!callback)
     {
-        w("write_callback(): strdup(old_locale) failed.");
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "write_callback(): Invalid 'callback' argument."
+        );
         goto cleanup;
     }
 
-    if (!setlocale(LC_ALL, "C"))
+    if (!data)
     {
-        w("write_callback(): setlocale(LC_ALL, \"C\") failed.");
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "write_callback(): Invalid 'data' argument."
+        );
         goto cleanup;
     }
 
-    if (0 > fprintf(file, "%s:", label)) 
+    flockfile(file);
+    locked = 1;
+
+    if (1 != fwrite(label->prefix, label->length, 1, file))
     {
-        w("write_callback(): Unable to write label.");
+        tioc_e(TIOC_ERROR_IO, "write_callback(): Unable to write label.");
+        goto cleanup;
     }
 
     if (-1 == (crc = callback(file, data))) goto cleanup;
 
-    if (0 > fprintf(file, "\n"))
+    if (EOF == putc_unlocked('\n', file))
     {
-        w("write_callback(): Unable to write newline.");
+        tioc_e(TIOC_ERROR_IO, "write_callback(): Unable to write newline.");
         goto cleanup;
     }
 
     rc = 0;
 
 cleanup:
-    if (old_locale2)
-    {
-        if (!setlocale(LC_ALL, old_locale2))
-        {
-            w("write_callback(): setlocale(LC_ALL, old_locale2) failed.");
-        }
-        free(old_locale2);
-    }
+    if (locked) funlockfile(file);
 
     if (rc || crc) return -1;
 
@@ -282,9 +547,13 @@ static int unsigned_writer(FILE *file, const void *data)
 {
     const unsigned long long *value = data;
 
-    if (0 > fprintf(file, "%llu", *value))
+    if (-1 == put_unsigned(file, *value))
     {
-        w("unsigned_writer(): fprintf() failed.");
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "unsigned_writer(): Unable to write unsigned value."
+        );
         return -1;
     }
 
@@ -293,13 +562,13 @@ static int unsigned_writer(FILE *file, const void *data)
 
 static int uuid_writer(FILE *file, const void *data)
 {
-    char uuid_string[37];
+    char uuid_string[TIOC_UUID_LENGTH];
     const uuid_t * const * uuid = data;
 
-    uuid_unparse(**uuid, uuid_string);
-    if (0 > fprintf(file, "%s", uuid_string)) 
+    tioc_format_uuid(uuid_string, **uuid);
+    if (1 != fwrite(uuid_string, TIOC_UUID_LENGTH, 1, file))
     {
-        w("uuid_writer(): fprintf() failed.");
+        tioc_e(TIOC_ERROR_IO, "uuid_writer(): fwrite() failed.");
         return -1;
     }
     return 0;
@@ -308,28 +577,65 @@ static int uuid_writer(FILE *file, const void *data)
 static int blob_writer(FILE *file, const void *data)
 {
     const struct wblob *wblob = data;
+    char length[TIOC_UNSIGNED_MAX + 1];
+    size_t len;
+
+    len = tioc_format_unsigned(length, wblob->size);
+    length[len++] = ':';
 
-    if (0 > fprintf(file, "%llu:", (unsigned long long)wblob->size))
+    if (1 != fwrite(length, len, 1, file))
     {
-        w("blob_writer(): fprintf() failed.");
+        tioc_e(TIOC_ERROR_IO, "blob_writer(): Unable to write blob length.");
         return -1;
     }
 
-    if (1 != fwrite(wblob->data, wblob->size, 1, file))
+    if (wblob->size && 1 != fwrite(wblob->data, wblob->size, 1, file))
     {
-        w("blob_writer(): fwrite() failed.");
+        tioc_e(TIOC_ERROR_IO, "blob_writer(): fwrite() failed.");
         return -1;
     }
 
     return 0;
 }
 
+static int blob_fd_writer(FILE *file, const void *data)
+{
+    const struct wblob_fd *b = data;
+    char length[TIOC_UNSIGNED_MAX + 1];
+    size_t len;
+
+    len = tioc_format_unsigned(length, b->size);
+    length[len++] = ':';
+
+    if (1 != fwrite(length, len, 1, file) || EOF == fflush(file))
+    {
+        tioc_e(TIOC_ERROR_IO, "blob_fd_writer(): Unable to write blob length.");
+        return -1;
+    }
+
+    return tioc_copy_range(b->fd, 0, fileno(file), b->size, "blob_fd_writer");
+}
+
 int write_unsigned
 (
     FILE *file,
     const char *label,
     unsigned long long value
 )
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return write_unsigned_l(file, &l, value);
+}
+
+int write_unsigned_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    unsigned long long value
+)
 {
     return write_callback
            (
@@ -346,6 +652,20 @@ int write_uuid
     const char *label,
     uuid_t uuid
 )
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return write_uuid_l(file, &l, uuid);
+}
+
+int write_uuid_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    uuid_t uuid
+)
 {
     return write_callback
            (
@@ -363,7 +683,21 @@ int write_string
     const char *string
 )
 {
-    return write_blob(file, label, string, strlen(string));
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return write_string_l(file, &l, string);
+}
+
+int write_string_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    const char *string
+)
+{
+    return write_blob_l(file, label, string, strlen(string));
 }
 
 int write_blob
@@ -373,6 +707,21 @@ int write_blob
     const char *blob,
     size_t size
 )
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return write_blob_l(file, &l, blob, size);
+}
+
+int write_blob_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    const char *blob,
+    size_t size
+)
 {
     struct wblob b;
 
@@ -388,47 +737,248 @@ int write_blob
            );
 }
 
-/*******************************************************************************
- * READ FUNCTION DEFINITIONS
- ******************************************************************************/
-
-int read_unsigned
+int write_blob_fd
 (
     FILE *file,
     const char *label,
-    unsigned long long *value
+    int fd
 )
 {
-    return read_callback
-           (
-                file,
-                label,
-                unsigned_reader,
-                value
-           );
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return write_blob_fd_l(file, &l, fd);
 }
 
-static int uuid_reader
+int write_blob_fd_l
 (
     FILE *file,
-    void *data
+    const tioc_label_t *label,
+    int fd
 )
 {
-    char uuid_string[37];
-    uuid_t **uuid;
+    struct wblob_fd b;
 
-    memset(uuid_string, 0, 37);
-    uuid = data;
+    /*
+     * Checked before anything is written, so that a bad descriptor does not
+     * leave a dangling label.
+     */
+    if (-1 == tioc_fd_size(fd, &b.size, "write_blob_fd_l")) return -1;
 
-    if (1 != fscanf(file, "%36c", uuid_string))
+    b.fd = fd;
+
+    return write_callback
+           (
+               file,
+               label,
+               blob_fd_writer,
+               &b
+           );
+}
+
+/*******************************************************************************
+ * READ FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+void tioc_set_read_limits(size_t max_size, size_t grow_threshold)
+{
+    __atomic_store_n(&read_max_size, max_size && max_size < SIZE_MAX ?
+            max_size : SIZE_MAX - 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&read_grow_threshold, grow_threshold, __ATOMIC_RELAXED);
+}
+
+static void get_limits
+(
+    const tioc_read_limits_t *limits,
+    size_t *max_size,
+    size_t *grow_threshold
+)
+{
+    if (!limits)
     {
-        w("uuid_reader(): Unable to read UUID.");
+        *max_size = __atomic_load_n(&read_max_size, __ATOMIC_RELAXED);
+        *grow_threshold = __atomic_load_n(&read_grow_threshold,
+                __ATOMIC_RELAXED);
+        return;
+    }
+
+    *max_size = limits->max_size && limits->max_size < SIZE_MAX ?
+        limits->max_size : SIZE_MAX - 1;
+    *grow_threshold = limits->grow_threshold;
+}
+
+static int get_payload
+(
+    FILE *file,
+    unsigned long long length,
+    tioc_arena_t *arena,
+    const tioc_read_limits_t *limits,
+    char **data,
+    const char *caller
+)
+{
+    int rc = -1;
+    char *buffer = NULL, *p;
+    size_t capacity = 0, have = 0, n, max_size, grow_threshold;
+
+    *data = NULL;
+
+    get_limits(limits, &max_size, &grow_threshold);
+
+    if (length > max_size)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_LIMIT,
+            "%s(): Length %llu exceeds the limit of %zu.",
+            caller,
+            length,
+            max_size
+        );
+        goto cleanup;
+    }
+
+    if (length <= grow_threshold)
+    {
+        if (!(*data = tioc_allocate(arena, length + 1)))
+        {
+            tioc_e
+            (
+                TIOC_ERROR_MEMORY,
+                "%s(): Unable to allocate memory.",
+                caller
+            );
+            goto cleanup;
+        }
+
+        if (length && 1 != fread(*data, length, 1, file))
+        {
+            tioc_e(file_error(file), "%s(): fread() failed.", caller);
+            goto cleanup;
+        }
+
+        (*data)[length] = 0;
+        rc = 0;
+        goto cleanup;
+    }
+
+    /*
+     * Trust the length only as far as the data bears it out: double the
+     * buffer each time it fills, so that it is never more than twice the size
+     * of what has actually been read.
+     */
+    while (have < length)
+    {
+        if (have == capacity)
+        {
+            capacity = capacity ? 2 * capacity : grow_threshold;
+            if (capacity < BUFSIZ) capacity = BUFSIZ;
+            if (capacity > length) capacity = (size_t)length;
+
+            if (!(p = realloc(buffer, capacity + 1)))
+            {
+                tioc_e
+                (
+                    TIOC_ERROR_MEMORY,
+                    "%s(): Unable to allocate memory.",
+                    caller
+                );
+                goto cleanup;
+            }
+
+            buffer = p;
+        }
+
+        if (!(n = fread(buffer + have, 1, capacity - have, file)))
+        {
+            tioc_e(file_error(file), "%s(): fread() failed.", caller);
+            goto cleanup;
+        }
+
+        have += n;
+    }
+
+    buffer[length] = 0;
+
+    if (!arena)
+    {
+        *data = buffer;
+        buffer = NULL;
+    }
+    else if ((*data = tioc_arena_alloc(arena, length + 1)))
+    {
+        memcpy(*data, buffer, length + 1);
+    }
+    else
+    {
+        goto cleanup;
+    }
+
+    rc = 0;
+
+cleanup:
+    free(buffer);
+
+    if (-1 == rc && *data)
+    {
+        tioc_release(arena, *data);
+        *data = NULL;
+    }
+
+    return rc;
+}
+
+int read_unsigned
+(
+    FILE *file,
+    const char *label,
+    unsigned long long *value
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return read_unsigned_l(file, &l, value);
+}
+
+int read_unsigned_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    unsigned long long *value
+)
+{
+    return read_callback
+           (
+                file,
+                label,
+                unsigned_reader,
+                value
+           );
+}
+
+static int uuid_reader
+(
+    FILE *file,
+    void *data
+)
+{
+    char uuid_string[TIOC_UUID_LENGTH];
+    uuid_t **uuid;
+
+    uuid = data;
+
+    if (1 != fread(uuid_string, TIOC_UUID_LENGTH, 1, file))
+    {
+        tioc_e(file_error(file), "uuid_reader(): Unable to read UUID.");
         return -1;
     }
 
-    if (0 != uuid_parse(uuid_string, **uuid))
+    if (-1 == tioc_parse_uuid(uuid_string, **uuid))
     {
-        w("uuid_reader(): Unable to parse UUID.");
+        tioc_e(TIOC_ERROR_FORMAT, "uuid_reader(): Unable to parse UUID.");
         return -1;
     }
 
@@ -441,6 +991,20 @@ int read_uuid
     const char *label,
     uuid_t uuid
 )
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return read_uuid_l(file, &l, uuid);
+}
+
+int read_uuid_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    uuid_t uuid
+)
 {
     return read_callback
            (
@@ -458,42 +1022,42 @@ static int string_reader
 )
 {
     int rc = -1;
-    char **string = data;
+    struct rblob *b = data;
+    char **string = b->data;
     unsigned long long length = 0;
 
     if (string) *string = NULL;
 
     if (!string)
     {
-        w("string_reader(): Invalid string.");
-        goto cleanup;
-    }
-
-    if (1 != fscanf(file, "%llu:", &length))
-    {
-        w("string_reader(): Unable to read string length.");
+        tioc_e(TIOC_ERROR_ARGUMENT, "string_reader(): Invalid string.");
         goto cleanup;
     }
 
-    if (!(*string = malloc(length + 1)))
+    if (-1 == get_unsigned(file, SIZE_MAX - 1, &length) ||
+        -1 == get_char(file, ':'))
     {
-        w("string_reader(): malloc() failed.");
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "string_reader(): Unable to read string length."
+        );
         goto cleanup;
     }
 
-    if (1 != fread(*string, length, 1, file))
+    if (-1 == get_payload(file, length, b->arena, b->limits, string,
+                "string_reader"))
     {
-        w("string_reader(): fread() failed.");
         goto cleanup;
     }
 
-    (*string)[length] = 0;
     rc = 0;
 
 cleanup:
     if (-1 == rc && string)
     {
-        free(*string);
+        tioc_release(b->arena, *string);
+        *string = NULL;
     }
 
     return rc;
@@ -506,12 +1070,292 @@ int read_string
     char **value
 )
 {
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return read_string_l(file, &l, value);
+}
+
+int read_string_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    char **value
+)
+{
+    return read_string_arena_l(file, label, NULL, value);
+}
+
+int read_string_arena
+(
+    FILE *file,
+    const char *label,
+    tioc_arena_t *arena,
+    char **value
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return read_string_arena_l(file, &l, arena, value);
+}
+
+int read_string_arena_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    char **value
+)
+{
+    return read_string_limited_l(file, label, arena, NULL, value);
+}
+
+int read_string_limited
+(
+    FILE *file,
+    const char *label,
+    tioc_arena_t *arena,
+    const tioc_read_limits_t *limits,
+    char **value
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return read_string_limited_l(file, &l, arena, limits, value);
+}
+
+int read_string_limited_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    const tioc_read_limits_t *limits,
+    char **value
+)
+{
+    struct rblob b;
+
+    b.data = value;
+    b.size = NULL;
+    b.arena = arena;
+    b.limits = limits;
+
     return read_callback
            (
                 file,
                 label,
                 string_reader,
-                value
+                &b
+           );
+}
+
+static int string_into_reader
+(
+    FILE *file,
+    void *data
+)
+{
+    int rc = -1;
+    struct rstring *b = data;
+    unsigned long long length = 0;
+    size_t max_size, grow_threshold;
+    char *buffer;
+
+    if (!b->length)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "string_into_reader(): Invalid 'length' argument."
+        );
+        goto cleanup;
+    }
+
+    if (-1 == get_unsigned(file, SIZE_MAX - 1, &length) ||
+        -1 == get_char(file, ':'))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "string_into_reader(): Unable to read string length."
+        );
+        goto cleanup;
+    }
+
+    get_limits(NULL, &max_size, &grow_threshold);
+
+    if (length > max_size)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_LIMIT,
+            "string_into_reader(): Length %llu exceeds the limit of %zu.",
+            length,
+            max_size
+        );
+        goto cleanup;
+    }
+
+    if (b->string)
+    {
+        buffer = tioc_string_reserve(b->string, length, "string_into_reader");
+        if (!buffer) goto cleanup;
+    }
+    else if (length >= b->capacity)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_CAPACITY,
+            "string_into_reader(): String of %llu bytes does not fit in %zu.",
+            length,
+            b->capacity
+        );
+
+        /*
+         * Skip the value, so that the file is left at the next field.
+         */
+        *(b->length) = length;
+
+        if (0 == skip_payload(file, length, "string_into_reader"))
+            get_char(file, '\n');
+
+        goto cleanup;
+    }
+    else
+    {
+        buffer = b->buffer;
+    }
+
+    if (length && 1 != fread(buffer, length, 1, file))
+    {
+        tioc_e(file_error(file), "string_into_reader(): fread() failed.");
+        goto cleanup;
+    }
+
+    buffer[length] = 0;
+    *(b->length) = length;
+    rc = 0;
+
+cleanup:
+    if (-1 == rc && b->string)
+    {
+        b->string->buffer[0] = 0;
+    }
+    else if (-1 == rc && b->capacity)
+    {
+        b->buffer[0] = 0;
+    }
+
+    return rc;
+}
+
+int read_string_into
+(
+    FILE *file,
+    const char *label,
+    char *buffer,
+    size_t capacity,
+    size_t *length
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return read_string_into_l(file, &l, buffer, capacity, length);
+}
+
+int read_string_into_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    char *buffer,
+    size_t capacity,
+    size_t *length
+)
+{
+    struct rstring b;
+
+    if (length) *length = 0;
+
+    if (!buffer || !capacity)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "read_string_into_l(): Invalid 'buffer' argument."
+        );
+        return -1;
+    }
+
+    *buffer = 0;
+
+    b.buffer = buffer;
+    b.capacity = capacity;
+    b.length = length;
+    b.string = NULL;
+
+    return read_callback
+           (
+                file,
+                label,
+                string_into_reader,
+                &b
+           );
+}
+
+int read_string_small
+(
+    FILE *file,
+    const char *label,
+    tioc_string_t *string
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return read_string_small_l(file, &l, string);
+}
+
+int read_string_small_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    tioc_string_t *string
+)
+{
+    struct rstring b;
+
+    if (!string)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "read_string_small_l(): Invalid 'string' argument."
+        );
+        return -1;
+    }
+
+    string->length = 0;
+    string->buffer[0] = 0;
+
+    b.buffer = NULL;
+    b.capacity = 0;
+    b.length = &string->length;
+    b.string = string;
+
+    return read_callback
+           (
+                file,
+                label,
+                string_into_reader,
+                &b
            );
 }
 
@@ -523,71 +1367,253 @@ static int blob_reader
 {
     int rc = -1;
     struct rblob *b;
+    unsigned long long length = 0;
 
     b = data;
 
-    if (b->data) *(b->data) = NULL;
+    if (b->data) *(b->data) = NULL;
+    if (b->size) *(b->size) = 0;
+
+    if (!b->data)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "blob_reader(): Invalid 'data' argument.");
+        goto cleanup;
+    }
+
+    if (!b->size)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "blob_reader(): Invalid 'size' argument.");
+        goto cleanup;
+    }
+
+    if (-1 == get_unsigned(file, SIZE_MAX - 1, &length) ||
+        -1 == get_char(file, ':'))
+    {
+        tioc_e(TIOC_ERROR_FORMAT, "blob_reader(): Unable to read blob length.");
+        goto cleanup;
+    }
+
+    if (-1 == get_payload(file, length, b->arena, b->limits, b->data,
+                "blob_reader"))
+    {
+        goto cleanup;
+    }
+
+    *(b->size) = length;
+    rc = 0;
+
+cleanup:
+    if (-1 == rc && *(b->data))
+    {
+        tioc_release(b->arena, *(b->data));
+        *(b->data) = NULL;
+    }
+
+    return rc;
+}
+
+int read_blob
+(
+    FILE *file,
+    const char *label,
+    char **data,
+    size_t *size
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return read_blob_l(file, &l, data, size);
+}
+
+int read_blob_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    char **data,
+    size_t *size
+)
+{
+    return read_blob_arena_l(file, label, NULL, data, size);
+}
+
+int read_blob_arena
+(
+    FILE *file,
+    const char *label,
+    tioc_arena_t *arena,
+    char **data,
+    size_t *size
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return read_blob_arena_l(file, &l, arena, data, size);
+}
+
+int read_blob_arena_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    char **data,
+    size_t *size
+)
+{
+    return read_blob_limited_l(file, label, arena, NULL, data, size);
+}
+
+int read_blob_limited
+(
+    FILE *file,
+    const char *label,
+    tioc_arena_t *arena,
+    const tioc_read_limits_t *limits,
+    char **data,
+    size_t *size
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return read_blob_limited_l(file, &l, arena, limits, data, size);
+}
+
+int read_blob_limited_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    const tioc_read_limits_t *limits,
+    char **data,
+    size_t *size
+)
+{
+    struct rblob b;
+
+    b.data = data;
+    b.size = size;
+    b.arena = arena;
+    b.limits = limits;
+
+    return read_callback
+           (
+                file,
+                label,
+                blob_reader,
+                &b
+           );
+}
+
+static int blob_fd_reader
+(
+    FILE *file,
+    void *data
+)
+{
+    struct rblob_fd *b = data;
+    unsigned long long length = 0;
+    char buffer[BUFSIZ];
+    size_t remaining, n;
+    off_t offset;
+
     if (b->size) *(b->size) = 0;
 
-    if (!b->data)
+    if (-1 == get_unsigned(file, SIZE_MAX - 1, &length) ||
+        -1 == get_char(file, ':'))
     {
-        w("blob_reader(): Invalid 'data' argument.");
-        goto cleanup;
+        tioc_e
+        (
+            TIOC_ERROR_FORMAT,
+            "blob_fd_reader(): Unable to read blob length."
+        );
+        return -1;
     }
 
-    if (!b->size)
+    /*
+     * The stream has probably read ahead into the payload, so the kernel can
+     * only be asked to copy it if the stream can then be moved past it.
+     */
+    if (-1 != (offset = ftello(file)))
     {
-        w("blob_reader(): Invalid 'size' argument.");
-        goto cleanup;
-    }
+        if (-1 == tioc_copy_range(fileno(file), offset, b->fd, length,
+                    "blob_fd_reader"))
+        {
+            return -1;
+        }
 
-    if (1 != fscanf(file, "%zu:", b->size))
-    {
-        w("blob_reader(): Unable to read blob length.");
-        goto cleanup;
+        if (-1 == fseeko(file, offset + (off_t)length, SEEK_SET))
+        {
+            tioc_e
+            (
+                TIOC_ERROR_IO,
+                "blob_fd_reader(): Unable to seek past blob."
+            );
+            return -1;
+        }
     }
-
-    if (!(*(b->data) = malloc(*(b->size))))
+    else
     {
-        w("blob_reader(): malloc() failed.");
-        goto cleanup;
+        for (remaining = length; remaining; remaining -= n)
+        {
+            n = remaining < sizeof(buffer) ? remaining : sizeof(buffer);
+
+            if (1 != fread(buffer, n, 1, file))
+            {
+                tioc_e(file_error(file), "blob_fd_reader(): fread() failed.");
+                return -1;
+            }
+
+            if (-1 == tioc_write_data(b->fd, buffer, n))
+            {
+                tioc_e(TIOC_ERROR_IO, "blob_fd_reader(): write() failed.");
+                return -1;
+            }
+        }
     }
 
-    if (1 != fread(*(b->data), *(b->size), 1, file))
-    {
-        w("blob_reader(): fread() failed.");
-        goto cleanup;
-    }
+    if (b->size) *(b->size) = length;
 
-    rc = 0;
+    return 0;
+}
 
-cleanup:
-    if (-1 == rc && *(b->data))
-    {
-        free(*(b->data));
-    }
+int read_blob_to_fd
+(
+    FILE *file,
+    const char *label,
+    int fd,
+    size_t *size
+)
+{
+    tioc_label_t l;
 
-    return rc;
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return read_blob_to_fd_l(file, &l, fd, size);
 }
 
-int read_blob
+int read_blob_to_fd_l
 (
     FILE *file,
-    const char *label,
-    char **data,
+    const tioc_label_t *label,
+    int fd,
     size_t *size
 )
 {
-    struct rblob b;
+    struct rblob_fd b;
 
-    b.data = data;
+    b.fd = fd;
     b.size = size;
 
     return read_callback
            (
                 file,
                 label,
-                blob_reader,
+                blob_fd_reader,
                 &b
            );
 }
@@ -599,102 +1625,81 @@ int read_blob
 static int read_callback
 (
     FILE *file,
-    const char *label,
+    const tioc_label_t *label,
     read_callback_t callback,
     void *data
 )
 {
     int rc = -1;
     int crc = -1;
-    char nl = 0, col = 0;
-    char *old_locale = NULL;
-    char *old_locale2 = NULL;
+    int locked = 0;
 
     if (!file)
     {
-        w("read_callback(): Invalid 'file' argument.");
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "read_callback(): Invalid 'file' argument."
+        );
         goto cleanup;
     }
     
     if (!label)
     {
-        w("read_callback(): Invalid 'label' argument.");
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "read_callback(): Invalid 'label' argument."
+        );
         goto cleanup;
     }
 
     if (!callback)
     {
-        w("read_callback(): Invalid 'callback' argument.");
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "read_callback(): Invalid 'callback' argument."
+        );
         goto cleanup;
     }
 
     if (!data)
     {
-        w("read_callback(): Invalid 'data' argument.");
-        goto cleanup;
-    }
-
-    if (!(old_locale = setlocale(LC_ALL, NULL)))
-    {
-        w("read_callback(): setlocale(LC_ALL, NULL) failed.");
-        goto cleanup;
-    }
-
-    if (!(old_locale2 = strdup(old_locale)))
-    {
-        w("read_callback(): strdup(old_locale) failed.");
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "read_callback(): Invalid 'data' argument."
+        );
         goto cleanup;
     }
 
-    if (!setlocale(LC_ALL, "C"))
-    {
-        w("read_callback(): setlocale(LC_ALL, \"C\") failed.");
-        goto cleanup;
-    }
+    flockfile(file);
+    locked = 1;
 
     if (-1 == expect_label(file, label))
     {
-        w("read_callback(): Unable to read label '%s'.", label);
-        goto cleanup;
-    }
-
-    if (1 != fscanf(file, "%c", &col))
-    {
-        w("read_callback(): Unable to read colon character.");
-        goto cleanup;
-    }
-
-    if (col != ':') 
-    {
-        w("read_callback(): Missing colon.");
+        tioc_w
+        (
+            "read_callback(): Unable to read label '%.*s'.",
+            (int)label->length - 1,
+            label->prefix
+        );
         goto cleanup;
     }
 
     if (-1 == (crc = callback(file, data))) goto cleanup;
 
-    if (1 != fscanf(file, "%c", &nl))
-    {
-        w("read_callback(): Unable to read newline character.");
-        goto cleanup;
-    }
-
-    if (nl != '\n') 
+    if (-1 == get_char(file, '\n'))
     {
-        w("read_callback(): Missing newline.");
+        tioc_e(TIOC_ERROR_FORMAT, "read_callback(): Missing newline.");
         goto cleanup;
     }
 
     rc = 0;
     
 cleanup:
-    if (old_locale2)
-    {
-        if (!setlocale(LC_ALL, old_locale2))
-        {
-            w("read_callback(): setlocale(LC_ALL, old_locale2) failed.");
-        }
-        free(old_locale2);
-    }
+    if (locked) funlockfile(file);
 
     if (rc || crc) return -1;
 
@@ -709,9 +1714,9 @@ static int unsigned_reader
 {
     unsigned long long *value = data;
 
-    if (1 != fscanf(file, "%llu", value))
+    if (-1 == get_unsigned(file, ULLONG_MAX, value))
     {
-        w("unsigned_reader(): Unable to read unsigned value.");
+        tioc_w("unsigned_reader(): Unable to read unsigned value.");
         return -1;
     }
 
@@ -725,46 +1730,48 @@ static int unsigned_reader
 static int expect_label
 (
     FILE *file,
-    const char *expected
+    const tioc_label_t *expected
 )
 {
     int rc = -1;
-    size_t len;
-    char fmt[16];
-    char actual[81];
+    char actual[TIOC_LABEL_MAX + 1];
 
     if (!file)
     {
-        w("expect_label(): Invalid 'file' argument.");
+        tioc_e(TIOC_ERROR_ARGUMENT, "expect_label(): Invalid 'file' argument.");
         goto cleanup;
     }
 
     if (!expected)
     {
-        w("expect_label(): Invalid 'expected' argument.");
-        goto cleanup;
-    }
-
-    if (!is_label_valid(expected))
-    {
-        w("expect_label(): Invalid label.");
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "expect_label(): Invalid 'expected' argument."
+        );
         goto cleanup;
     }
 
-    len = strlen(expected);
-
-    memset(actual, 0, 81);
-    snprintf(fmt, 16, "%%%uc", (unsigned)len);
-
-    if (1 != fscanf(file, fmt, actual))
+    if (1 != fread(actual, expected->length, 1, file))
     {
-        w("expect_label(): Unable to read label.");
+        tioc_e(file_error(file), "expect_label(): Unable to read label.");
         goto cleanup;
     }
 
-    if (0 != strcmp(expected, actual)) 
-    {
-        w("expect_label(): Expected '%s' but found '%s'.", expected, actual);
+    /*
+     * The prefix includes the colon, so this checks both at once.
+     */
+    if (memcmp(expected->prefix, actual, expected->length))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_LABEL,
+            "expect_label(): Expected '%.*s' but found '%.*s'.",
+            (int)expected->length - 1,
+            expected->prefix,
+            (int)expected->length - 1,
+            actual
+        );
         goto cleanup;
     }
 
@@ -780,18 +1787,38 @@ int expect_unsigned
     const char *label,
     unsigned long long expected
 )
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return expect_unsigned_l(file, &l, expected);
+}
+
+int expect_unsigned_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    unsigned long long expected
+)
 {
     unsigned long long actual;
 
-    if (-1 == read_unsigned(file, label, &actual))
+    if (-1 == read_unsigned_l(file, label, &actual))
     {
-        w("expect_unsigned(): Unable to read unsigned value.");
+        tioc_w("expect_unsigned(): Unable to read unsigned value.");
         return -1;
     }
 
     if (expected != actual) 
     {
-        w("expect_unsigned(): Expected %llu but read %llu.", expected, actual);
+        tioc_e
+        (
+            TIOC_ERROR_MISMATCH,
+            "expect_unsigned(): Expected %llu but read %llu.",
+            expected,
+            actual
+        );
         return -1;
     }
 
@@ -804,20 +1831,40 @@ int expect_uuid
     const char *label,
     uuid_t expected
 )
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return expect_uuid_l(file, &l, expected);
+}
+
+int expect_uuid_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    uuid_t expected
+)
 {
     uuid_t actual;
     char expected_str[37];
 
-    if (-1 == read_uuid(file, label, actual))
+    if (-1 == read_uuid_l(file, label, actual))
     {
-        w("expect_uuid(): Unable to read UUID.");
+        tioc_w("expect_uuid(): Unable to read UUID.");
         return -1;
     }
 
-    if (0 != uuid_compare(expected, actual)) 
+    if (memcmp(expected, actual, sizeof(uuid_t)))
     {
-        uuid_unparse(expected, expected_str);
-        w("expect_uuid(): Expected UUID '%s' not found.", expected_str);
+        tioc_format_uuid(expected_str, expected);
+        expected_str[TIOC_UUID_LENGTH] = 0;
+        tioc_e
+        (
+            TIOC_ERROR_MISMATCH,
+            "expect_uuid(): Expected UUID '%s' not found.",
+            expected_str
+        );
         return -1;
     }
 
@@ -830,25 +1877,49 @@ int expect_string
     const char *label,
     const char *expected
 )
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return expect_string_l(file, &l, expected);
+}
+
+int expect_string_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    const char *expected
+)
 {
     int rc = -1;
     char *actual = NULL;
 
     if (!expected)
     {
-        w("expect_string(): Invalid 'expected' argument.");
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "expect_string(): Invalid 'expected' argument."
+        );
         goto cleanup;
     }
     
-    if (-1 == read_string(file, label, &actual))
+    if (-1 == read_string_l(file, label, &actual))
     {
-        w("expect_string(): Unable to read string.");
+        tioc_w("expect_string(): Unable to read string.");
         goto cleanup;
     }
 
     if (strcmp(expected, actual))
     {
-        w("expect_string(): Expected '%s' but found '%s'.", expected, actual);
+        tioc_e
+        (
+            TIOC_ERROR_MISMATCH,
+            "expect_string(): Expected '%s' but found '%s'.",
+            expected,
+            actual
+        );
         goto cleanup;
     }
 
@@ -859,6 +1930,359 @@ cleanup:
     return rc;
 }
 
+/*******************************************************************************
+ * SCAN FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+static int get_label(FILE *file, char *label, size_t *length, int *next)
+{
+    int c = EOF;
+
+    *length = 0;
+
+    while (*length <= TIOC_LABEL_MAX && EOF != (c = getc_unlocked(file)) &&
+           ':' != c && '\n' != c)
+    {
+        label[(*length)++] = (char)c;
+    }
+
+    *next = c;
+
+    if (':' != c || !*length || *length > TIOC_LABEL_MAX) return -1;
+
+    label[*length] = 0;
+    return 0;
+}
+
+static int skip_payload
+(
+    FILE *file,
+    unsigned long long length,
+    const char *caller
+)
+{
+    char buffer[BUFSIZ];
+    size_t n;
+
+    if (length <= (unsigned long long)INT64_MAX &&
+        (unsigned long long)(off_t)length == length &&
+        0 == fseeko(file, (off_t)length, SEEK_CUR))
+    {
+        return 0;
+    }
+
+    for (; length; length -= n)
+    {
+        n = length < sizeof(buffer) ? (size_t)length : sizeof(buffer);
+
+        if (1 != fread(buffer, n, 1, file))
+        {
+            tioc_e(file_error(file), "%s(): Unable to skip payload.", caller);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int tioc_peek_label(FILE *file, char *label)
+{
+    int rc = -1, next;
+    size_t length;
+    off_t offset;
+
+    if (!file || !label)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "tioc_peek_label(): Invalid argument.");
+        return -1;
+    }
+
+    label[0] = 0;
+
+    flockfile(file);
+
+    if (-1 == (offset = ftello(file)))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_peek_label(): The stream is not seekable."
+        );
+        funlockfile(file);
+        return -1;
+    }
+
+    if (-1 == get_label(file, label, &length, &next))
+    {
+        if (EOF == next)
+        {
+            tioc_e(file_error(file), "tioc_peek_label(): No label found.");
+        }
+        else
+        {
+            tioc_e(TIOC_ERROR_FORMAT, "tioc_peek_label(): Invalid label.");
+        }
+    }
+    else
+    {
+        rc = 0;
+    }
+
+    /*
+     * Go back to where the label started, whether or not it was one, so that
+     * the stream is left as it was found.
+     */
+    if (-1 == fseeko(file, offset, SEEK_SET))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "tioc_peek_label(): Unable to restore the position."
+        );
+        rc = -1;
+    }
+
+    funlockfile(file);
+
+    if (-1 == rc) label[0] = 0;
+
+    return rc;
+}
+
+int tioc_skip(FILE *file)
+{
+    int rc = -1, c, next;
+    char label[TIOC_LABEL_MAX + 1];
+    size_t length, digits = 0;
+    unsigned long long value = 0;
+
+    if (!file)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "tioc_skip(): Invalid 'file' argument.");
+        return -1;
+    }
+
+    flockfile(file);
+
+    if (-1 == get_label(file, label, &length, &next))
+    {
+        if (EOF == next)
+        {
+            tioc_e(file_error(file), "tioc_skip(): No label found.");
+        }
+        else
+        {
+            tioc_e(TIOC_ERROR_FORMAT, "tioc_skip(): Invalid label.");
+        }
+        goto cleanup;
+    }
+
+    /*
+     * A value that starts with a length and a colon is a string or blob, which
+     * is skipped by its length; anything else runs to the end of the line.
+     */
+    while (EOF != (c = getc_unlocked(file)) && '0' <= c && c <= '9' &&
+           digits < TIOC_UNSIGNED_MAX - 1)
+    {
+        value = 10 * value + (unsigned long long)(c - '0');
+        ++digits;
+    }
+
+    if (':' == c && digits)
+    {
+        if (-1 == skip_payload(file, value, "tioc_skip")) goto cleanup;
+
+        if (-1 == get_char(file, '\n'))
+        {
+            tioc_e(TIOC_ERROR_FORMAT, "tioc_skip(): Missing newline.");
+            goto cleanup;
+        }
+    }
+    else
+    {
+        while (EOF != c && '\n' != c) c = getc_unlocked(file);
+
+        if (EOF == c)
+        {
+            tioc_e(file_error(file), "tioc_skip(): Missing newline.");
+            goto cleanup;
+        }
+    }
+
+    rc = 0;
+
+cleanup:
+    funlockfile(file);
+    return rc;
+}
+
+/*******************************************************************************
+ * RECORD FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+int tioc_write_record
+(
+    FILE *file,
+    const tioc_schema_t *schema,
+    const void *record
+)
+{
+    const struct tioc_schema_field *field;
+    const char *value;
+    struct wblob b;
+    size_t i;
+    int rc = -1;
+
+    if (!file || !schema || !record)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "tioc_write_record(): Invalid argument.");
+        return -1;
+    }
+
+    /*
+     * write_callback() takes the lock again for each field, but the lock is
+     * recursive, and holding it here keeps the record together.
+     */
+    flockfile(file);
+
+    for (i = 0; i < schema->count; ++i)
+    {
+        field = &schema->fields[i];
+        value = (const char*)record + field->offset;
+
+        switch (field->type)
+        {
+            case TIOC_TYPE_UNSIGNED:
+                if (-1 == write_callback(file, &field->label, unsigned_writer,
+                            value))
+                {
+                    goto cleanup;
+                }
+                break;
+
+            case TIOC_TYPE_UUID:
+                if (-1 == write_callback(file, &field->label, uuid_writer,
+                            &value))
+                {
+                    goto cleanup;
+                }
+                break;
+
+            case TIOC_TYPE_STRING:
+            case TIOC_TYPE_BLOB:
+                b.data = *(const char * const *)value;
+
+                if (TIOC_TYPE_STRING == field->type)
+                {
+                    if (!b.data)
+                    {
+                        tioc_e
+                        (
+                            TIOC_ERROR_ARGUMENT,
+                            "tioc_write_record(): Invalid string."
+                        );
+                        goto cleanup;
+                    }
+                    b.size = strlen(b.data);
+                }
+                else
+                {
+                    b.size = *(const size_t*)((const char*)record +
+                            field->size_offset);
+                }
+
+                if (-1 == write_callback(file, &field->label, blob_writer, &b))
+                    goto cleanup;
+                break;
+        }
+    }
+
+    rc = 0;
+
+cleanup:
+    funlockfile(file);
+    return rc;
+}
+
+int tioc_read_record
+(
+    FILE *file,
+    const tioc_schema_t *schema,
+    void *record
+)
+{
+    const struct tioc_schema_field *field;
+    char *value;
+    struct rblob b;
+    size_t i;
+    int rc = -1;
+
+    if (!file || !schema || !record)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "tioc_read_record(): Invalid argument.");
+        return -1;
+    }
+
+    flockfile(file);
+
+    for (i = 0; i < schema->count; ++i)
+    {
+        field = &schema->fields[i];
+        value = (char*)record + field->offset;
+
+        switch (field->type)
+        {
+            case TIOC_TYPE_UNSIGNED:
+                if (-1 == read_callback(file, &field->label, unsigned_reader,
+                            value))
+                {
+                    goto cleanup;
+                }
+                break;
+
+            case TIOC_TYPE_UUID:
+                if (-1 == read_callback(file, &field->label, uuid_reader,
+                            &value))
+                {
+                    goto cleanup;
+                }
+                break;
+
+            case TIOC_TYPE_STRING:
+                b.data = (char**)value;
+                b.size = NULL;
+                b.arena = NULL;
+                b.limits = NULL;
+
+                if (-1 == read_callback(file, &field->label, string_reader,
+                            &b))
+                {
+                    goto cleanup;
+                }
+                break;
+
+            case TIOC_TYPE_BLOB:
+                b.data = (char**)value;
+                b.size = (size_t*)((char*)record + field->size_offset);
+                b.arena = NULL;
+                b.limits = NULL;
+
+                if (-1 == read_callback(file, &field->label, blob_reader, &b))
+                    goto cleanup;
+                break;
+        }
+    }
+
+    rc = 0;
+
+cleanup:
+    funlockfile(file);
+
+    if (rc) tioc_free_fields(schema, record, i);
+
+    return rc;
+}
+
 /*******************************************************************************
  * FILE FUNCTION DEFINITIONS
  ******************************************************************************/
@@ -866,7 +2290,7 @@ cleanup:
 int read_file_content(const char *filename, char **data, size_t *size)
 {
     int rc = -1;
-    FILE *file;
+    FILE *file = NULL;
     long offset;
 
     if (data) *data = NULL;
@@ -874,63 +2298,99 @@ int read_file_content(const char *filename, char **data, size_t *size)
 
     if (!filename)
     {
-        w("read_file_content(): Invalid 'filename' argument.");
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "read_file_content(): Invalid 'filename' argument."
+        );
         goto cleanup;
     }
 
     if (!data)
     {
-        w("read_file_content(): Invalid 'data' argument.");
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "read_file_content(): Invalid 'data' argument."
+        );
         goto cleanup;
     }
 
     if (!size)
     {
-        w("read_file_content(): Invalid 'size' argument.");
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "read_file_content(): Invalid 'size' argument."
+        );
         goto cleanup;
     }
 
     file = fopen(filename, "rb");
     if (!file)
     {
-        w("read_file_content(): Unable to open file '%s'.", filename);
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "read_file_content(): Unable to open file '%s'.",
+            filename
+        );
         goto cleanup;
     }
 
     if (-1 == fseek(file, 0, SEEK_END))
     {
-        fclose(file);
-        w("read_file_content(): Unable to seek to the end of the file '%s'.", filename);
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "read_file_content(): Unable to seek to the end of the file '%s'.",
+            filename
+        );
         goto cleanup;
     }
 
     if (-1 == (offset = ftell(file)))
     {
-        fclose(file);
-        w("read_file_content(): Unable to obtain offset of file '%s'.", filename);
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "read_file_content(): Unable to obtain offset of file '%s'.",
+            filename
+        );
         goto cleanup;
     }
 
     if (-1 == fseek(file, 0, SEEK_SET))
     {
-        fclose(file);
-        w("read_file_content(): Unable to seek to the beginning of the file '%s'.", filename);
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "read_file_content(): Unable to seek to the beginning of the file '%s'.",
+            filename
+        );
         goto cleanup;
     }
 
     *data = (char*)malloc(offset + 1);
     if (!*data)
     {
-        fclose(file);
-        w("read_file_content(): Unable to allocate data for file '%s'.", filename);
+        tioc_e
+        (
+            TIOC_ERROR_MEMORY,
+            "read_file_content(): Unable to allocate data for file '%s'.",
+            filename
+        );
         goto cleanup;
     }
 
-    if (1 != fread(*data, offset, 1, file))
+    if (offset && 1 != fread(*data, offset, 1, file))
     {
-        free(*data);
-        fclose(file);
-        w("read_file_content(): Unable to read file content '%s'.", filename);
+        tioc_e
+        (
+            TIOC_ERROR_IO,
+            "read_file_content(): Unable to read file content '%s'.",
+            filename
+        );
         goto cleanup;
     }
 
@@ -944,13 +2404,14 @@ cleanup:
     {
         if (EOF == fclose(file))
         {
-            w("read_file_content(): Error closing file.");
+            tioc_e(TIOC_ERROR_IO, "read_file_content(): Error closing file.");
         }
     }
 
-    if (-1 == rc)
+    if (-1 == rc && data)
     {
-        if (data) free(*data);
+        free(*data);
+        *data = NULL;
     }
 
     return rc;
@@ -16,6 +16,302 @@
  * characters 'a' through 'z', and '_' (basically C identifiers minus digits).
  ******************************************************************************/
 
+/*******************************************************************************
+ * ERROR FUNCTION DECLARATIONS
+ *
+ * Functions that fail return -1 (or NULL), and record what went wrong as the
+ * calling thread's last error, which, like errno, is only meaningful straight
+ * after a failure.
+ *
+ * Each failure is also passed to the error handler, once for every function on
+ * the way out that has something to add.  By default, the handler prints the
+ * messages to standard error, e.g.:
+ *
+ *     libtioc: expect_label(): Expected 'a' but found 'b'.
+ *     libtioc: read_callback(): Unable to read label 'a'.
+ *
+ * The message of the function that detects a failure is formatted once, and
+ * kept for tioc_last_error_message().  Those of the functions that pass it on
+ * are only formatted when there is a handler, so silencing the handler saves
+ * most of the cost for applications in which failure is routine, such as
+ * those that use the expect functions as a predicate.
+ ******************************************************************************/
+
+/*
+ * What went wrong.
+ */
+typedef enum tioc_error
+{
+    TIOC_ERROR_NONE,
+
+    /*
+     * An argument was invalid, or the call is not allowed in the current
+     * state (e.g. while a group is active).
+     */
+    TIOC_ERROR_ARGUMENT,
+
+    /*
+     * Memory could not be allocated.
+     */
+    TIOC_ERROR_MEMORY,
+
+    /*
+     * A system call or stdio function failed.
+     */
+    TIOC_ERROR_IO,
+
+    /*
+     * The input ended part of the way through a field, or before one.
+     */
+    TIOC_ERROR_END,
+
+    /*
+     * The input is malformed.
+     */
+    TIOC_ERROR_FORMAT,
+
+    /*
+     * The field does not have the label expected.
+     */
+    TIOC_ERROR_LABEL,
+
+    /*
+     * The field does not have the type expected.
+     */
+    TIOC_ERROR_TYPE,
+
+    /*
+     * The field does not have the value expected by an expect function.
+     */
+    TIOC_ERROR_MISMATCH,
+
+    /*
+     * A length exceeds a limit (see tioc_set_read_limits()).
+     */
+    TIOC_ERROR_LIMIT,
+
+    /*
+     * A value does not fit in the buffer supplied.
+     */
+    TIOC_ERROR_CAPACITY,
+
+    /*
+     * A field of checked data does not match its checksum.
+     */
+    TIOC_ERROR_CHECKSUM
+} tioc_error_t;
+
+/*
+ * Receives a failure: what went wrong, a message of the form
+ * "<function>(): <details>.", and the context given to
+ * tioc_set_error_handler().  The message is only valid until the handler
+ * returns.
+ */
+typedef void (*tioc_error_handler_t)
+(
+    tioc_error_t error,
+    const char *message,
+    void *context
+);
+
+/*
+ * Sets the function that receives failures, for the whole process.  A NULL
+ * handler silences them.  The handler is called on the thread that failed, so
+ * it must be thread-safe if the library is used from several threads.
+ *
+ * The handler and its context are read without synchronization, so they must
+ * be set before other threads start using the library, and not changed while
+ * any are.
+ */
+void tioc_set_error_handler(tioc_error_handler_t handler, void *context);
+
+/*
+ * The default handler, which prints "libtioc: <message>" to standard error.
+ */
+void tioc_print_error(tioc_error_t error, const char *message, void *context);
+
+/*
+ * Returns the calling thread's last error.
+ */
+tioc_error_t tioc_last_error(void);
+
+/*
+ * Returns the message of the calling thread's last error, as passed to the
+ * handler by the function that detected it, e.g. "expect_unsigned(): Expected
+ * 175 but read 176.", whether or not there was a handler at the time.  The
+ * string is in storage that belongs to the thread, and is overwritten by its
+ * next failure.
+ */
+const char *tioc_last_error_message(void);
+
+/*
+ * Returns a description of error, e.g. "Value mismatch".
+ */
+const char *tioc_error_string(tioc_error_t error);
+
+/*******************************************************************************
+ * LABEL FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * The maximum length of a label, in bytes.
+ */
+#define TIOC_LABEL_MAX 80
+
+/*
+ * A validated label, ready to be written or compared.
+ *
+ * Every function that takes a label as a string validates it and measures it
+ * on every call.  Functions with an "_l" suffix take one of these instead, so
+ * that this is done once, when the label is created.
+ */
+typedef struct tioc_label
+{
+    /*
+     * The length of the prefix, including the colon.
+     */
+    size_t length;
+
+    /*
+     * A hash of the prefix, used to find the label in a tioc_reader_t group.
+     */
+    unsigned int hash;
+
+    /*
+     * The label followed by a colon, i.e. "<label>:", NULL-terminated.
+     */
+    char prefix[TIOC_LABEL_MAX + 2];
+} tioc_label_t;
+
+/*
+ * Creates a label from name, which must be a valid label.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_label_init(tioc_label_t *label, const char *name);
+
+/*******************************************************************************
+ * ARENA FUNCTION DECLARATIONS
+ *
+ * An arena is a bump allocator.  Strings and blobs read with the "_arena"
+ * functions are allocated from one instead of with malloc(), and are freed all
+ * at once when it is reset or destroyed, rather than one by one.
+ ******************************************************************************/
+
+typedef struct tioc_arena tioc_arena_t;
+
+/*
+ * Creates an arena that allocates memory chunk_size bytes at a time (or 64KB
+ * if chunk_size is 0).  Allocations larger than this get a chunk of their own.
+ *
+ * Returns NULL on failure.
+ */
+tioc_arena_t *tioc_arena_create(size_t chunk_size);
+
+/*
+ * Allocates size bytes from the arena, suitably aligned for any type.  The
+ * memory must not be passed to free().
+ *
+ * Returns NULL on failure.
+ */
+void *tioc_arena_alloc(tioc_arena_t *arena, size_t size);
+
+/*
+ * Frees everything allocated from the arena, keeping its chunks for reuse.
+ */
+void tioc_arena_reset(tioc_arena_t *arena);
+
+/*
+ * Frees everything allocated from the arena, and the arena itself.
+ */
+void tioc_arena_destroy(tioc_arena_t *arena);
+
+/*******************************************************************************
+ * SMALL STRING FUNCTION DECLARATIONS
+ *
+ * A tioc_string_t holds a string read by the "_small" functions.  Strings
+ * shorter than TIOC_STRING_INLINE bytes are stored in the structure itself;
+ * longer ones go in a heap buffer, which is kept and reused by later reads
+ * into the same tioc_string_t until it is freed.
+ ******************************************************************************/
+
+/*
+ * The size of the storage inside a tioc_string_t, including the terminator.
+ */
+#define TIOC_STRING_INLINE 32
+
+typedef struct tioc_string
+{
+    /*
+     * The length of the string, without the terminator.
+     */
+    size_t length;
+
+    /*
+     * The heap buffer, if one has been needed, and its size.
+     */
+    char *heap;
+    size_t capacity;
+
+    char buffer[TIOC_STRING_INLINE];
+} tioc_string_t;
+
+/*
+ * Initialises string to the empty string.
+ */
+void tioc_string_init(tioc_string_t *string);
+
+/*
+ * Returns the string's NULL-terminated data, which is valid until the next
+ * read into it, or until it is freed.
+ */
+const char *tioc_string_data(const tioc_string_t *string);
+
+/*
+ * Frees any heap buffer held by string, leaving it empty.
+ */
+void tioc_string_free(tioc_string_t *string);
+
+/*******************************************************************************
+ * LIMIT FUNCTION DECLARATIONS
+ *
+ * The length of a string or blob comes from the input, so a corrupt or
+ * hostile length prefix could otherwise make a read allocate any amount of
+ * memory before it finds that the data is not there.
+ ******************************************************************************/
+
+/*
+ * The default size above which the FILE functions grow a value's buffer as
+ * its bytes arrive.
+ */
+#define TIOC_GROW_THRESHOLD (1024 * 1024)
+
+/*
+ * Limits on the strings and blobs read by the FILE functions.  A value whose
+ * length exceeds max_size (0 meaning no limit) is rejected before any memory
+ * is allocated for it.  A value whose length exceeds grow_threshold is read
+ * into a buffer that starts at grow_threshold bytes and doubles as the data
+ * arrives, so that memory is only committed for data that is actually there.
+ *
+ * A FILE carries no state of the library's, so limits for a particular input
+ * are given to read_string_limited() and read_blob_limited(), and belong to
+ * the caller.
+ */
+typedef struct tioc_read_limits
+{
+    size_t max_size;
+    size_t grow_threshold;
+} tioc_read_limits_t;
+
+/*
+ * Sets the limits used by the FILE functions that are not given any (no limit
+ * on size and a grow_threshold of TIOC_GROW_THRESHOLD by default), for the
+ * whole process.  The limits are read atomically, but a reader in another
+ * thread may see the new max_size with the old grow_threshold, so they are
+ * best set before reading starts.
+ */
+void tioc_set_read_limits(size_t max_size, size_t grow_threshold);
+
 /*******************************************************************************
  * WRITE FUNCTION DECLARATIONS
  ******************************************************************************/
@@ -34,6 +330,16 @@ int write_unsigned
     unsigned long long value
 );
 
+/*
+ * As write_unsigned(), but with a label created by tioc_label_init().
+ */
+int write_unsigned_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    unsigned long long value
+);
+
 /*
  * Writes a UUID to the file.
  *
@@ -50,6 +356,16 @@ int write_uuid
     uuid_t uuid
 );
 
+/*
+ * As write_uuid(), but with a label created by tioc_label_init().
+ */
+int write_uuid_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    uuid_t uuid
+);
+
 /*
  * Writes a NULL-terminated string to the file specified.
  *
@@ -66,6 +382,16 @@ int write_string
     const char *string
 );
 
+/*
+ * As write_string(), but with a label created by tioc_label_init().
+ */
+int write_string_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    const char *string
+);
+
 /*
  * Writes a blob to the file specified.
  *
@@ -83,6 +409,44 @@ int write_blob
     size_t size
 );
 
+/*
+ * As write_blob(), but with a label created by tioc_label_init().
+ */
+int write_blob_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    const char *blob,
+    size_t size
+);
+
+/*
+ * Writes a blob whose payload is the whole of fd, which must be a regular
+ * file.  The size is taken from fstat().
+ *
+ * The label and length are written to the file, which is then flushed, and
+ * the payload is copied from fd to the file's descriptor by the kernel (with
+ * copy_file_range(), sendfile() or splice()), so it is never held in memory.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int write_blob_fd
+(
+    FILE *file,
+    const char *label,
+    int fd
+);
+
+/*
+ * As write_blob_fd(), but with a label created by tioc_label_init().
+ */
+int write_blob_fd_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    int fd
+);
+
 /*******************************************************************************
  * READ FUNCTION DECLARATIONS
  ******************************************************************************/
@@ -99,6 +463,16 @@ int read_unsigned
     unsigned long long *value
 );
 
+/*
+ * As read_unsigned(), but with a label created by tioc_label_init().
+ */
+int read_unsigned_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    unsigned long long *value
+);
+
 /*
  * Reads a UUID from the file.
  *
@@ -111,6 +485,16 @@ int read_uuid
     uuid_t uuid
 );
 
+/*
+ * As read_uuid(), but with a label created by tioc_label_init().
+ */
+int read_uuid_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    uuid_t uuid
+);
+
 /*
  * Reads a string from the file.
  *
@@ -125,6 +509,16 @@ int read_string
     char **value
 );
 
+/*
+ * As read_string(), but with a label created by tioc_label_init().
+ */
+int read_string_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    char **value
+);
+
 /*
  * Reads a blob from the file.
  *
@@ -140,55 +534,1344 @@ int read_blob
     size_t *size
 );
 
-/*******************************************************************************
- * EXPECT FUNCTION DECLARATIONS
- ******************************************************************************/
+/*
+ * As read_blob(), but with a label created by tioc_label_init().
+ */
+int read_blob_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    char **data,
+    size_t *size
+);
 
 /*
- * Expects an unsigned value from a value.
+ * Reads a blob, writing its payload to fd instead of into memory.  If size is
+ * not NULL, it is set to the size of the payload.
  *
- * This is the same as read_unsigned, except that if the value that is read
- * does not match the value supplied, an error is returned.
+ * If the file is seekable, the payload is copied by the kernel and the file is
+ * repositioned after it; otherwise, it passes through a small buffer.  Either
+ * way, it is never held in memory as a whole.
  *
  * Returns -1 on failure, 0 on success.
  */
-int expect_unsigned
+int read_blob_to_fd
 (
     FILE *file,
     const char *label,
-    unsigned long long expected
+    int fd,
+    size_t *size
 );
 
 /*
- * Expect an exact UUID from the file.
- *
- * This is similar to read_uuid, but if the uuid in the file
- * does not match the UUID specified, an error is returned.
- *
- * Returns -1 on failure, 0 on success.
+ * As read_blob_to_fd(), but with a label created by tioc_label_init().
  */
-int expect_uuid
+int read_blob_to_fd_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    int fd,
+    size_t *size
+);
+
+/*
+ * As read_string(), but the string is allocated from the arena, and must not
+ * be free()'d.  If arena is NULL, this is the same as read_string().
+ */
+int read_string_arena
 (
     FILE *file,
     const char *label,
-    uuid_t expected
+    tioc_arena_t *arena,
+    char **value
 );
 
 /*
- * Expect an exact string from the file.
- *
- * This is similar to read_string, but if the string in the file
- * does not match the string specified, an error is returned.
- *
- * Returns -1 on failure, 0 on success.
+ * As read_string_arena(), but with a label created by tioc_label_init().
  */
-int expect_string
+int read_string_arena_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    char **value
+);
+
+/*
+ * As read_blob(), but the blob is allocated from the arena, and must not be
+ * free()'d.  If arena is NULL, this is the same as read_blob().
+ */
+int read_blob_arena
 (
     FILE *file,
     const char *label,
-    const char *expected
+    tioc_arena_t *arena,
+    char **data,
+    size_t *size
+);
+
+/*
+ * As read_blob_arena(), but with a label created by tioc_label_init().
+ */
+int read_blob_arena_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    char **data,
+    size_t *size
+);
+
+/*
+ * As read_string_arena(), but subject to the limits given rather than those
+ * set by tioc_set_read_limits() (which apply if limits is NULL).
+ */
+int read_string_limited
+(
+    FILE *file,
+    const char *label,
+    tioc_arena_t *arena,
+    const tioc_read_limits_t *limits,
+    char **value
+);
+
+/*
+ * As read_string_limited(), but with a label created by tioc_label_init().
+ */
+int read_string_limited_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    const tioc_read_limits_t *limits,
+    char **value
 );
 
+/*
+ * As read_blob_arena(), but subject to the limits given rather than those set
+ * by tioc_set_read_limits() (which apply if limits is NULL).
+ */
+int read_blob_limited
+(
+    FILE *file,
+    const char *label,
+    tioc_arena_t *arena,
+    const tioc_read_limits_t *limits,
+    char **data,
+    size_t *size
+);
+
+/*
+ * As read_blob_limited(), but with a label created by tioc_label_init().
+ */
+int read_blob_limited_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    const tioc_read_limits_t *limits,
+    char **data,
+    size_t *size
+);
+
+/*
+ * Reads a string into buffer, which is capacity bytes long, and terminates it.
+ * *length is set to the length of the string, without the terminator.
+ *
+ * If the string does not fit (*length >= capacity), the value is skipped and
+ * -1 is returned, with *length still set, so the caller can tell this from
+ * other failures.  The value cannot be read again from the file.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int read_string_into
+(
+    FILE *file,
+    const char *label,
+    char *buffer,
+    size_t capacity,
+    size_t *length
+);
+
+/*
+ * As read_string_into(), but with a label created by tioc_label_init().
+ */
+int read_string_into_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    char *buffer,
+    size_t capacity,
+    size_t *length
+);
+
+/*
+ * Reads a string into a tioc_string_t, which must have been initialised with
+ * tioc_string_init().  Memory is only allocated if the string is too long to
+ * be stored inline and longer than any heap buffer that string already has.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int read_string_small
+(
+    FILE *file,
+    const char *label,
+    tioc_string_t *string
+);
+
+/*
+ * As read_string_small(), but with a label created by tioc_label_init().
+ */
+int read_string_small_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    tioc_string_t *string
+);
+
+/*******************************************************************************
+ * EXPECT FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Expects an unsigned value from a value.
+ *
+ * This is the same as read_unsigned, except that if the value that is read
+ * does not match the value supplied, an error is returned.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int expect_unsigned
+(
+    FILE *file,
+    const char *label,
+    unsigned long long expected
+);
+
+/*
+ * As expect_unsigned(), but with a label created by tioc_label_init().
+ */
+int expect_unsigned_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    unsigned long long expected
+);
+
+/*
+ * Expect an exact UUID from the file.
+ *
+ * This is similar to read_uuid, but if the uuid in the file
+ * does not match the UUID specified, an error is returned.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int expect_uuid
+(
+    FILE *file,
+    const char *label,
+    uuid_t expected
+);
+
+/*
+ * As expect_uuid(), but with a label created by tioc_label_init().
+ */
+int expect_uuid_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    uuid_t expected
+);
+
+/*
+ * Expect an exact string from the file.
+ *
+ * This is similar to read_string, but if the string in the file
+ * does not match the string specified, an error is returned.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int expect_string
+(
+    FILE *file,
+    const char *label,
+    const char *expected
+);
+
+/*
+ * As expect_string(), but with a label created by tioc_label_init().
+ */
+int expect_string_l
+(
+    FILE *file,
+    const tioc_label_t *label,
+    const char *expected
+);
+
+/*******************************************************************************
+ * SCAN FUNCTION DECLARATIONS
+ *
+ * For moving through data without knowing its layout in advance, e.g. to find
+ * a few small fields among large blobs.
+ ******************************************************************************/
+
+/*
+ * Reads the label of the next field into label, which must have room for
+ * TIOC_LABEL_MAX + 1 bytes, without consuming it, so that the next read,
+ * expect or skip still sees the whole field.  The label is NULL-terminated,
+ * without its colon.
+ *
+ * The stream must be seekable: its position is noted with ftello() and
+ * restored with fseeko() afterwards, as C only guarantees one byte of
+ * pushback.  On a stream that is not, this fails before anything is read
+ * (use tioc_reader_peek_label() on a reader instead).
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_peek_label(FILE *file, char *label);
+
+/*
+ * Moves past the next field, whatever its label and type.  The payload of a
+ * string or blob is skipped using its length, with fseeko() where the stream
+ * allows it, and otherwise by reading it through a small buffer; it is never
+ * held in memory.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_skip(FILE *file);
+
+/*******************************************************************************
+ * WRITER FUNCTION DECLARATIONS
+ *
+ * A writer is an alternative to the FILE-based write functions above.  It owns
+ * a file descriptor and an output buffer, formats records directly into the
+ * buffer, and only calls write(2) when the buffer is full (or when flushed).
+ *
+ * The output is byte-for-byte identical to that of the write_xxx() functions,
+ * unless the writer was created with TIOC_ENCODING_BINARY.
+ *
+ * The binary encoding carries the same fields as the text encoding, more
+ * compactly.  It starts with an 8-byte magic number, after which each field
+ * is an LEB128 varint tag, (label id << 3) | kind, followed by:
+ *
+ *   - for an unsigned value, the value as a varint;
+ *   - for a UUID, its 16 bytes;
+ *   - for a string or blob, its length as a varint and then its bytes.
+ *
+ * Label ids are assigned in order of first use, and the first field with each
+ * label is preceded by a definition of the id: a tag of kind 4, and the label
+ * as a varint length and its bytes.  There are no newlines.
+ *
+ * TIOC_ENCODING_CHECKED is the binary encoding with a different magic number
+ * and, after each field, the CRC32C of every byte since the end of the last
+ * (the field and any definitions before it) as 4 bytes, least significant
+ * first.  Readers verify each checksum as they read its field, failing with
+ * TIOC_ERROR_CHECKSUM if it does not match, so corruption of a value is
+ * detected before the value is returned.
+ ******************************************************************************/
+
+typedef struct tioc_writer tioc_writer_t;
+
+/*
+ * The encodings that a writer can produce.  Readers detect the encoding of
+ * their data.
+ */
+typedef enum tioc_encoding
+{
+    TIOC_ENCODING_TEXT,
+    TIOC_ENCODING_BINARY,
+    TIOC_ENCODING_CHECKED
+} tioc_encoding_t;
+
+/*
+ * Creates a writer for the file descriptor specified.
+ *
+ * The size is the size of the output buffer, in bytes.  If size is 0, a
+ * default size is used.  Sizes smaller than a single record are rounded up.
+ *
+ * The writer takes ownership of fd, which is closed by tioc_writer_close().
+ *
+ * Returns NULL on failure.
+ */
+tioc_writer_t *tioc_writer_open(int fd, size_t size);
+
+/*
+ * As tioc_writer_open(), but producing the encoding specified.
+ */
+tioc_writer_t *tioc_writer_open_encoding
+(
+    int fd,
+    size_t size,
+    tioc_encoding_t encoding
+);
+
+/*
+ * Called by an asynchronous writer as each buffer finishes being written, with
+ * the number of bytes written and, if the write failed, its errno (otherwise
+ * 0).  It is called on the thread using the writer, from within a writer
+ * function.
+ */
+typedef void (*tioc_write_completion_t)
+(
+    size_t bytes,
+    int error,
+    void *context
+);
+
+/*
+ * As tioc_writer_open_encoding(), but writing asynchronously with io_uring.
+ *
+ * The writer has the number of buffers specified (at least 2), each of size
+ * bytes, and fills one while the others are written.  When it needs a buffer
+ * that is still being written, it waits, so no more memory than this is used
+ * however fast records are written.
+ *
+ * Writes to a regular file can be in flight in every buffer but the one being
+ * filled; for other descriptors, or one opened with O_APPEND, one write is in
+ * flight at a time.  tioc_writer_flush() waits for all of them to complete.
+ *
+ * The completion function, if not NULL, is called with the context given for
+ * each buffer written.  The first write to fail makes subsequent writer calls
+ * fail with TIOC_ERROR_IO.
+ *
+ * Where io_uring is not available, buffers are written synchronously.
+ *
+ * Returns NULL on failure.
+ */
+tioc_writer_t *tioc_writer_open_async
+(
+    int fd,
+    size_t size,
+    size_t buffers,
+    tioc_encoding_t encoding,
+    tioc_write_completion_t completion,
+    void *context
+);
+
+/*
+ * Flushes any buffered data, closes the file descriptor and frees the writer.
+ *
+ * Returns -1 on failure (in which case buffered data may have been lost), 0 on
+ * success.  The writer is freed in either case.
+ */
+int tioc_writer_close(tioc_writer_t *writer);
+
+/*
+ * Writes any buffered data to the file descriptor.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_writer_flush(tioc_writer_t *writer);
+
+/*
+ * Writes an unsigned value.  See write_unsigned().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_writer_write_unsigned
+(
+    tioc_writer_t *writer,
+    const char *label,
+    unsigned long long value
+);
+
+/*
+ * As tioc_writer_write_unsigned(), but with a label created by
+ * tioc_label_init().
+ */
+int tioc_writer_write_unsigned_l
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    unsigned long long value
+);
+
+/*
+ * Writes a UUID.  See write_uuid().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_writer_write_uuid
+(
+    tioc_writer_t *writer,
+    const char *label,
+    uuid_t uuid
+);
+
+/*
+ * As tioc_writer_write_uuid(), but with a label created by tioc_label_init().
+ */
+int tioc_writer_write_uuid_l
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    uuid_t uuid
+);
+
+/*
+ * Writes a NULL-terminated string.  See write_string().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_writer_write_string
+(
+    tioc_writer_t *writer,
+    const char *label,
+    const char *string
+);
+
+/*
+ * As tioc_writer_write_string(), but with a label created by tioc_label_init().
+ */
+int tioc_writer_write_string_l
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    const char *string
+);
+
+/*
+ * Writes a blob.  See write_blob().
+ *
+ * Blobs that do not fit in the buffer are passed to the kernel directly with
+ * writev(2), together with whatever is already buffered, rather than being
+ * copied.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_writer_write_blob
+(
+    tioc_writer_t *writer,
+    const char *label,
+    const char *blob,
+    size_t size
+);
+
+/*
+ * As tioc_writer_write_blob(), but with a label created by tioc_label_init().
+ */
+int tioc_writer_write_blob_l
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    const char *blob,
+    size_t size
+);
+
+/*
+ * Writes a blob whose payload is the whole of fd.  See write_blob_fd().
+ *
+ * The buffer is flushed before the payload is copied.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_writer_write_blob_fd
+(
+    tioc_writer_t *writer,
+    const char *label,
+    int fd
+);
+
+/*
+ * As tioc_writer_write_blob_fd(), but with a label created by
+ * tioc_label_init().
+ */
+int tioc_writer_write_blob_fd_l
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    int fd
+);
+
+/*******************************************************************************
+ * READER FUNCTION DECLARATIONS
+ *
+ * A reader is an alternative to the FILE-based read and expect functions
+ * above.  It parses records from a contiguous span of memory and keeps an
+ * explicit position within it.
+ *
+ * Unlike the FILE-based functions, a reader function that fails leaves the
+ * position unchanged, so the caller can retry with a different label or type.
+ *
+ * Readers accept either encoding (see WRITER FUNCTION DECLARATIONS), and the
+ * read and expect functions behave the same for both.  Groups, and therefore
+ * indexes, are only supported for text.
+ ******************************************************************************/
+
+typedef struct tioc_reader tioc_reader_t;
+
+/*
+ * A view of a string or blob within a reader's data.
+ *
+ * Views are not terminated, and are only valid until the reader is closed.
+ */
+typedef struct tioc_view
+{
+    const char *data;
+    size_t size;
+} tioc_view_t;
+
+/*
+ * Creates a reader over the size bytes at data.
+ *
+ * The data is not copied, and must remain valid until the reader is closed.
+ *
+ * Returns NULL on failure.
+ */
+tioc_reader_t *tioc_reader_open(const char *data, size_t size);
+
+/*
+ * Creates a reader over the file specified, which is mapped into memory
+ * rather than read.  The kernel is advised that the mapping will be read
+ * sequentially.
+ *
+ * Returns NULL on failure.
+ */
+tioc_reader_t *tioc_reader_map(const char *filename);
+
+/*
+ * Frees the reader, unmapping the file if it was created by
+ * tioc_reader_map().
+ */
+void tioc_reader_close(tioc_reader_t *reader);
+
+/*
+ * Returns the offset of the next unread byte.
+ */
+size_t tioc_reader_tell(const tioc_reader_t *reader);
+
+/*
+ * Returns 1 if every byte has been read, otherwise 0.
+ */
+int tioc_reader_eof(const tioc_reader_t *reader);
+
+/*
+ * Sets the largest string or blob that the reader will accept (0 meaning no
+ * limit, the default).  A longer value is rejected as soon as its length is
+ * read, by the view functions as well as by those that copy.
+ *
+ * A reader's data is already in memory, and no length may exceed what is left
+ * of it, so there is no need for the chunked growth of the FILE functions.
+ */
+void tioc_reader_set_limit(tioc_reader_t *reader, size_t max_size);
+
+/*
+ * Returns the encoding of the reader's data.
+ */
+tioc_encoding_t tioc_reader_encoding(const tioc_reader_t *reader);
+
+/*
+ * Copies every field from the reader's position to the end of its data to the
+ * writer, converting between the reader's encoding and the writer's.
+ *
+ * Converting text to binary and back reproduces the text exactly, including
+ * values that the write functions would not have produced.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_transcode(tioc_reader_t *reader, tioc_writer_t *writer);
+
+/*
+ * Sets *label and *length to the label of the next field (within the reader's
+ * data, so not NULL-terminated) without moving past it.
+ *
+ * For checked data, the field's checksum is not verified; that is left to the
+ * function that goes on to read it.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_peek_label
+(
+    tioc_reader_t *reader,
+    const char **label,
+    size_t *length
+);
+
+/*
+ * Moves past the next field, whatever its label and type, stepping over the
+ * payloads of strings and blobs without reading them.
+ *
+ * For checked data, this means that the field's checksum, which covers its
+ * payload, is not verified either.  tioc_reader_verify() checks every field.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_skip(tioc_reader_t *reader);
+
+/*
+ * Moves the position to offset, which should be the start of a field.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_seek(tioc_reader_t *reader, size_t offset);
+
+/*
+ * Scans the group of fields at the reader's position and indexes them by
+ * label, using the length prefixes to skip over strings and blobs.  Until
+ * tioc_reader_end_group() is called, the read and expect functions look their
+ * label up in the group, so fields can be read in any order (or not at all),
+ * and the position does not move.
+ *
+ * If count is non-zero, the group is the next count fields.  Otherwise, the
+ * group ends at the end of the data or just before the first label that
+ * appears a second time, i.e. at the start of the next record.  If a label
+ * appears more than once in a group, the first occurrence is used.
+ *
+ * Returns -1 on failure (in which case the reader is unchanged), 0 on success.
+ */
+int tioc_reader_begin_group(tioc_reader_t *reader, size_t count);
+
+/*
+ * Leaves group mode, moving the position past the end of the group.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_end_group(tioc_reader_t *reader);
+
+/*
+ * Reads an unsigned value.  See read_unsigned().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_read_unsigned
+(
+    tioc_reader_t *reader,
+    const char *label,
+    unsigned long long *value
+);
+
+/*
+ * As tioc_reader_read_unsigned(), but with a label created by
+ * tioc_label_init().
+ */
+int tioc_reader_read_unsigned_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    unsigned long long *value
+);
+
+/*
+ * Reads a UUID.  See read_uuid().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_read_uuid
+(
+    tioc_reader_t *reader,
+    const char *label,
+    uuid_t uuid
+);
+
+/*
+ * As tioc_reader_read_uuid(), but with a label created by tioc_label_init().
+ */
+int tioc_reader_read_uuid_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    uuid_t uuid
+);
+
+/*
+ * Reads a string.  See read_string().
+ *
+ * Returns -1 on failure, 0 on success.
+ *
+ * The resulting string should be free()'d.
+ */
+int tioc_reader_read_string
+(
+    tioc_reader_t *reader,
+    const char *label,
+    char **value
+);
+
+/*
+ * As tioc_reader_read_string(), but with a label created by tioc_label_init().
+ */
+int tioc_reader_read_string_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    char **value
+);
+
+/*
+ * Reads a blob.  See read_blob().
+ *
+ * Returns -1 on failure, 0 on success.
+ *
+ * The resulting blob should be free()'d.
+ */
+int tioc_reader_read_blob
+(
+    tioc_reader_t *reader,
+    const char *label,
+    char **data,
+    size_t *size
+);
+
+/*
+ * As tioc_reader_read_blob(), but with a label created by tioc_label_init().
+ */
+int tioc_reader_read_blob_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    char **data,
+    size_t *size
+);
+
+/*
+ * Reads a blob, writing its payload to fd.  See read_blob_to_fd().
+ *
+ * For a reader created by tioc_reader_map(), the payload is copied from the
+ * file by the kernel without touching the mapping; otherwise, it is written
+ * from the reader's data.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_read_blob_to_fd
+(
+    tioc_reader_t *reader,
+    const char *label,
+    int fd,
+    size_t *size
+);
+
+/*
+ * As tioc_reader_read_blob_to_fd(), but with a label created by
+ * tioc_label_init().
+ */
+int tioc_reader_read_blob_to_fd_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    int fd,
+    size_t *size
+);
+
+/*
+ * Reads a string into memory allocated from the arena.  See
+ * read_string_arena().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_read_string_arena
+(
+    tioc_reader_t *reader,
+    const char *label,
+    tioc_arena_t *arena,
+    char **value
+);
+
+/*
+ * As tioc_reader_read_string_arena(), but with a label created by
+ * tioc_label_init().
+ */
+int tioc_reader_read_string_arena_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    char **value
+);
+
+/*
+ * Reads a blob into memory allocated from the arena.  See read_blob_arena().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_read_blob_arena
+(
+    tioc_reader_t *reader,
+    const char *label,
+    tioc_arena_t *arena,
+    char **data,
+    size_t *size
+);
+
+/*
+ * As tioc_reader_read_blob_arena(), but with a label created by
+ * tioc_label_init().
+ */
+int tioc_reader_read_blob_arena_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    tioc_arena_t *arena,
+    char **data,
+    size_t *size
+);
+
+/*
+ * Reads a string into buffer, which is capacity bytes long.  See
+ * read_string_into().  If the string does not fit, the reader's position is
+ * left on the field, so it can be read again with a larger buffer.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_read_string_into
+(
+    tioc_reader_t *reader,
+    const char *label,
+    char *buffer,
+    size_t capacity,
+    size_t *length
+);
+
+/*
+ * As tioc_reader_read_string_into(), but with a label created by
+ * tioc_label_init().
+ */
+int tioc_reader_read_string_into_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    char *buffer,
+    size_t capacity,
+    size_t *length
+);
+
+/*
+ * Reads a string into a tioc_string_t.  See read_string_small().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_read_string_small
+(
+    tioc_reader_t *reader,
+    const char *label,
+    tioc_string_t *string
+);
+
+/*
+ * As tioc_reader_read_string_small(), but with a label created by
+ * tioc_label_init().
+ */
+int tioc_reader_read_string_small_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    tioc_string_t *string
+);
+
+/*
+ * Reads a string without copying it.
+ *
+ * On success, view describes the string within the reader's data.  Nothing is
+ * allocated.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_read_string_view
+(
+    tioc_reader_t *reader,
+    const char *label,
+    tioc_view_t *view
+);
+
+/*
+ * As tioc_reader_read_string_view(), but with a label created by
+ * tioc_label_init().
+ */
+int tioc_reader_read_string_view_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    tioc_view_t *view
+);
+
+/*
+ * Reads a blob without copying it.  See tioc_reader_read_string_view().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_read_blob_view
+(
+    tioc_reader_t *reader,
+    const char *label,
+    tioc_view_t *view
+);
+
+/*
+ * As tioc_reader_read_blob_view(), but with a label created by
+ * tioc_label_init().
+ */
+int tioc_reader_read_blob_view_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    tioc_view_t *view
+);
+
+/*
+ * Expects an exact unsigned value.  See expect_unsigned().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_expect_unsigned
+(
+    tioc_reader_t *reader,
+    const char *label,
+    unsigned long long expected
+);
+
+/*
+ * As tioc_reader_expect_unsigned(), but with a label created by
+ * tioc_label_init().
+ */
+int tioc_reader_expect_unsigned_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    unsigned long long expected
+);
+
+/*
+ * Expects an exact UUID.  See expect_uuid().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_expect_uuid
+(
+    tioc_reader_t *reader,
+    const char *label,
+    uuid_t expected
+);
+
+/*
+ * As tioc_reader_expect_uuid(), but with a label created by tioc_label_init().
+ */
+int tioc_reader_expect_uuid_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    uuid_t expected
+);
+
+/*
+ * Expects an exact string.  See expect_string().
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_expect_string
+(
+    tioc_reader_t *reader,
+    const char *label,
+    const char *expected
+);
+
+/*
+ * As tioc_reader_expect_string(), but with a label created by
+ * tioc_label_init().
+ */
+int tioc_reader_expect_string_l
+(
+    tioc_reader_t *reader,
+    const tioc_label_t *label,
+    const char *expected
+);
+
+/*******************************************************************************
+ * SCHEMA FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * The type of a field in a record.
+ */
+typedef enum tioc_type
+{
+    /*
+     * An unsigned long long.
+     */
+    TIOC_TYPE_UNSIGNED,
+
+    /*
+     * A uuid_t.
+     */
+    TIOC_TYPE_UUID,
+
+    /*
+     * A NULL-terminated char *, allocated with malloc() when read.
+     */
+    TIOC_TYPE_STRING,
+
+    /*
+     * A char * and a size_t length, the former allocated with malloc() when
+     * read.
+     */
+    TIOC_TYPE_BLOB
+} tioc_type_t;
+
+/*
+ * Describes one field of a record: its label, its type and where its value is
+ * stored in the C struct that holds the record.
+ */
+typedef struct tioc_field
+{
+    const char *label;
+    tioc_type_t type;
+
+    /*
+     * The offset of the value within the struct, as given by offsetof().
+     */
+    size_t offset;
+
+    /*
+     * For TIOC_TYPE_BLOB, the offset of the size_t length within the struct.
+     * Ignored for other types.
+     */
+    size_t size_offset;
+} tioc_field_t;
+
+/*
+ * An ordered list of fields, compiled once and then used to read and write
+ * whole records.
+ */
+typedef struct tioc_schema tioc_schema_t;
+
+/*
+ * Compiles the count fields into a schema.  The labels are validated here, and
+ * the fields array is not referenced after this returns.
+ *
+ * Returns NULL on failure.
+ */
+tioc_schema_t *tioc_schema_compile(const tioc_field_t *fields, size_t count);
+
+/*
+ * Frees the schema.
+ */
+void tioc_schema_free(tioc_schema_t *schema);
+
+/*
+ * Frees the strings and blobs of a record that was read with the schema, and
+ * sets their pointers to NULL.  The record itself is not freed.
+ */
+void tioc_free_record(const tioc_schema_t *schema, void *record);
+
+/*
+ * Writes every field of the record to the file, in schema order, holding the
+ * file's lock for the whole record.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_write_record
+(
+    FILE *file,
+    const tioc_schema_t *schema,
+    const void *record
+);
+
+/*
+ * Reads every field of the record from the file, in schema order, holding the
+ * file's lock for the whole record.  On failure, nothing needs to be freed.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_read_record
+(
+    FILE *file,
+    const tioc_schema_t *schema,
+    void *record
+);
+
+/*
+ * Writes every field of the record to the writer's buffer, in schema order.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_writer_write_record
+(
+    tioc_writer_t *writer,
+    const tioc_schema_t *schema,
+    const void *record
+);
+
+/*
+ * Reads every field of the record from the reader, in schema order.  On
+ * failure, nothing needs to be freed and the position is unchanged.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_read_record
+(
+    tioc_reader_t *reader,
+    const tioc_schema_t *schema,
+    void *record
+);
+
+/*******************************************************************************
+ * INDEX FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * A sidecar index of a tioc file.
+ *
+ * The file is divided into records, each of which ends just before the first
+ * label that it repeats (see tioc_reader_begin_group()), and the records are
+ * divided into blocks of a fixed number of records.  For each block, the index
+ * holds its offset, the set of labels that appear in it and, for every label
+ * whose values in the block are all unsigned, their minimum and maximum.
+ */
+typedef struct tioc_index tioc_index_t;
+
+/*
+ * The default number of records per block.
+ */
+#define TIOC_INDEX_BLOCK_RECORDS 1024
+
+/*
+ * Builds an index of the file, with block_records records per block (or
+ * TIOC_INDEX_BLOCK_RECORDS if block_records is 0).
+ *
+ * Returns NULL on failure.
+ */
+tioc_index_t *tioc_index_build(const char *filename, size_t block_records);
+
+/*
+ * Writes the index to a file.  The index is itself tioc data.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_index_save(const tioc_index_t *index, const char *filename);
+
+/*
+ * Reads an index written by tioc_index_save().
+ *
+ * Returns NULL on failure.
+ */
+tioc_index_t *tioc_index_load(const char *filename);
+
+/*
+ * Frees the index.
+ */
+void tioc_index_free(tioc_index_t *index);
+
+/*
+ * Returns the number of records in the indexed file.
+ */
+size_t tioc_index_records(const tioc_index_t *index);
+
+/*
+ * Moves the reader to the start of record number record (counting from 0),
+ * jumping straight to its block and then skipping the records before it.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+int tioc_reader_seek_record
+(
+    tioc_reader_t *reader,
+    const tioc_index_t *index,
+    size_t record
+);
+
+/*
+ * Moves the reader to the first record, at or after its position (which must
+ * be the start of a record), that contains the label.  Blocks in which the
+ * label does not appear are skipped without being read.
+ *
+ * Returns -1 on failure, 1 if there is no such record (in which case the
+ * position is unchanged), 0 on success.
+ */
+int tioc_reader_seek_label
+(
+    tioc_reader_t *reader,
+    const tioc_index_t *index,
+    const tioc_label_t *label
+);
+
+/*
+ * As tioc_reader_seek_label(), but for the first record in which the label has
+ * the unsigned value given.  Blocks whose range for the label does not include
+ * value are skipped without being read.
+ */
+int tioc_reader_seek_unsigned
+(
+    tioc_reader_t *reader,
+    const tioc_index_t *index,
+    const tioc_label_t *label,
+    unsigned long long value
+);
+
+/*******************************************************************************
+ * PARALLEL FUNCTION DECLARATIONS
+ *
+ * Text data can be parsed on several threads at once.  It is divided into
+ * chunks of roughly equal size, each of which starts at a record, where a
+ * record is taken to start at every field with the label of the first field
+ * (i.e. the field at the reader's position).  Chunk boundaries are found by
+ * following the lengths of strings and blobs, so values that contain newlines
+ * and labels do not split records.
+ ******************************************************************************/
+
+/*
+ * Parses one chunk, through a reader over just that chunk's data.  Chunks are
+ * numbered from 0 in the order that they appear in the data, and may be empty.
+ *
+ * This is called on a worker thread, concurrently with other chunks, so it
+ * should keep what it parses by chunk number for the merger to collect.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+typedef int (*tioc_chunk_parser_t)
+(
+    tioc_reader_t *reader,
+    size_t chunk,
+    void *context
+);
+
+/*
+ * Collects the results of one parsed chunk.  This is called on the thread that
+ * called tioc_reader_parse_parallel(), for each chunk in order.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+typedef int (*tioc_chunk_merger_t)(size_t chunk, void *context);
+
+/*
+ * Divides the data from the reader's position (which must be at the start of a
+ * record) to its end into chunks, parses them with parse on threads worker
+ * threads, and passes each to merge (unless it is NULL) in order as soon as it
+ * and the chunks before it have been parsed.
+ *
+ * threads may be 0 for one per online processor, and chunks may be 0 for one
+ * per thread.  More chunks than threads evens out chunks that take longer.
+ *
+ * Binary data is not supported, as it cannot be divided without reading the
+ * labels that it defines along the way.
+ *
+ * Returns -1 on failure (having stopped at the first chunk that failed), 0 on
+ * success, in which case the reader is at the end of its data.
+ */
+int tioc_reader_parse_parallel
+(
+    tioc_reader_t *reader,
+    size_t threads,
+    size_t chunks,
+    tioc_chunk_parser_t parse,
+    tioc_chunk_merger_t merge,
+    void *context
+);
+
+/*
+ * Checks that the data from the reader's position to its end is well formed,
+ * on threads threads (or one per online processor if threads is 0): that every
+ * label is valid, that every value is a length and a payload of that length, a
+ * UUID or an unsigned value, and that every field ends with a newline.
+ * Nothing is allocated for each field.
+ *
+ * Binary data is checked on the calling thread, as it defines its labels along
+ * the way.  For checked data, this includes every field's checksum.
+ *
+ * Returns -1 on failure, in which case, if the data is malformed, *offset (if
+ * offset is not NULL) is set to that of the first bad byte (or, for binary,
+ * the start of the first bad field), and otherwise to SIZE_MAX.  Returns 0 on
+ * success, in which case the reader is at the end of its data.
+ */
+int tioc_reader_verify(tioc_reader_t *reader, size_t threads, size_t *offset);
+
 /*******************************************************************************
  * FILE FUNCTION DECLARATIONS
  ******************************************************************************/
@@ -0,0 +1,65 @@
+#include "tioc.h"
+#include "internal.h"
+
+/*******************************************************************************
+ * OVERVIEW
+ *
+ * Conversion between the text and binary encodings.  Each field is read with
+ * tioc_reader_next_field(), which says which writer function produces it, and
+ * written with that function.  Text values that no writer function produces
+ * exactly are carried verbatim as TIOC_KIND_RAW fields.
+ ******************************************************************************/
+
+/*******************************************************************************
+ * TRANSCODE FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+int tioc_transcode(tioc_reader_t *reader, tioc_writer_t *writer)
+{
+    struct tioc_any_field field;
+    tioc_label_t label;
+    int rc = 0;
+
+    if (!reader || !writer)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "tioc_transcode(): Invalid argument.");
+        return -1;
+    }
+
+    while (0 == rc && !tioc_reader_eof(reader))
+    {
+        if (-1 == tioc_reader_next_field(reader, &field) ||
+            -1 == tioc_label_set(&label, field.label, field.length))
+        {
+            tioc_w
+            (
+                "tioc_transcode(): Unable to read field at offset %zu.",
+                tioc_reader_tell(reader)
+            );
+            return -1;
+        }
+
+        switch (field.kind)
+        {
+            case TIOC_KIND_UNSIGNED:
+                rc = tioc_writer_write_unsigned_l(writer, &label, field.value);
+                break;
+
+            case TIOC_KIND_UUID:
+                rc = tioc_writer_write_uuid_l(writer, &label, field.uuid);
+                break;
+
+            case TIOC_KIND_BLOB:
+                rc = tioc_writer_write_blob_l(writer, &label, field.data,
+                        field.size);
+                break;
+
+            default:
+                rc = tioc_writer_write_raw_l(writer, &label, field.data,
+                        field.size);
+                break;
+        }
+    }
+
+    return rc;
+}
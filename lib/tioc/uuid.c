@@ -0,0 +1,287 @@
+#include "internal.h"
+#include <string.h>
+
+#ifdef TIOC_X86
+#include <immintrin.h>
+#endif
+
+/*******************************************************************************
+ * OVERVIEW
+ *
+ * Conversion between UUIDs and their canonical 8-4-4-4-12 textual form,
+ * without going through libuuid.
+ *
+ * Formatting splits the 16 bytes into nibbles, looks each one up in a 16-entry
+ * table with a single shuffle, and then shuffles the 32 hexadecimal digits
+ * into place around the dashes.
+ *
+ * Parsing does the reverse: it checks the dashes, shuffles the 32 digits out
+ * from between them, validates and converts them all at once, and packs pairs
+ * of nibbles back into bytes with a multiply-add.
+ *
+ * On x86, SSE4.1 versions are selected at startup when the CPU supports them;
+ * elsewhere (and on older CPUs) scalar versions are used.
+ ******************************************************************************/
+
+/*******************************************************************************
+ * TYPES
+ ******************************************************************************/
+
+typedef void (*format_t)(char *buffer, const unsigned char *uuid);
+typedef int (*parse_t)(const char *text, unsigned char *uuid);
+
+/*******************************************************************************
+ * UUID FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * The scalar format_t and parse_t.
+ */
+static void format_scalar(char *buffer, const unsigned char *uuid);
+static int parse_scalar(const char *text, unsigned char *uuid);
+
+#ifdef TIOC_X86
+/*
+ * The SSE4.1 format_t and parse_t.
+ */
+static void format_sse41(char *buffer, const unsigned char *uuid);
+static int parse_sse41(const char *text, unsigned char *uuid);
+
+/*
+ * Selects the fastest versions that the CPU supports.
+ */
+static void select_implementation(void) __attribute__((constructor));
+#endif
+
+/*******************************************************************************
+ * IMPLEMENTATION SELECTION
+ ******************************************************************************/
+
+static format_t format = format_scalar;
+static parse_t parse = parse_scalar;
+
+#ifdef TIOC_X86
+static void select_implementation(void)
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        format = format_sse41;
+        parse = parse_sse41;
+    }
+}
+#endif
+
+/*******************************************************************************
+ * UUID FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+void tioc_format_uuid(char *buffer, const unsigned char *uuid)
+{
+    format(buffer, uuid);
+}
+
+int tioc_parse_uuid(const char *text, unsigned char *uuid)
+{
+    return parse(text, uuid);
+}
+
+static void format_scalar(char *buffer, const unsigned char *uuid)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t i;
+
+    for (i = 0; i < 16; ++i)
+    {
+        if (4 == i || 6 == i || 8 == i || 10 == i) *buffer++ = '-';
+
+        *buffer++ = hex[uuid[i] >> 4];
+        *buffer++ = hex[uuid[i] & 0x0f];
+    }
+}
+
+static int parse_scalar(const char *text, unsigned char *uuid)
+{
+    size_t i;
+    int n, nibble[2];
+    char c;
+
+    if ('-' != text[8] || '-' != text[13] ||
+        '-' != text[18] || '-' != text[23])
+    {
+        return -1;
+    }
+
+    for (i = 0; i < 16; ++i)
+    {
+        if (4 == i || 6 == i || 8 == i || 10 == i) ++text;
+
+        for (n = 0; n < 2; ++n)
+        {
+            c = *text++;
+
+            if ('0' <= c && c <= '9') nibble[n] = c - '0';
+            else if ('a' <= c && c <= 'f') nibble[n] = c - 'a' + 10;
+            else if ('A' <= c && c <= 'F') nibble[n] = c - 'A' + 10;
+            else return -1;
+        }
+
+        uuid[i] = (unsigned char)(nibble[0] << 4 | nibble[1]);
+    }
+
+    return 0;
+}
+
+#ifdef TIOC_X86
+#define Z -128
+
+__attribute__((target("sse4.1")))
+static void format_sse41(char *buffer, const unsigned char *uuid)
+{
+    __m128i v, hi, lo, a, b, dashes;
+    int tail;
+
+    v = _mm_loadu_si128((const __m128i*)uuid);
+
+    hi = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+    lo = _mm_and_si128(v, _mm_set1_epi8(0x0f));
+
+    hi = _mm_shuffle_epi8(_mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'), hi);
+    lo = _mm_shuffle_epi8(_mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'), lo);
+
+    /*
+     * a and b hold the digits of bytes 0-7 and 8-15 respectively.
+     */
+    a = _mm_unpacklo_epi8(hi, lo);
+    b = _mm_unpackhi_epi8(hi, lo);
+
+    /*
+     * Output bytes 0-15: a0-a7 - a8-a11 - a12 a13
+     */
+    dashes = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0,
+                           '-', 0, 0, 0, 0, '-', 0, 0);
+    v = _mm_shuffle_epi8(a, _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                Z, 8, 9, 10, 11, Z, 12, 13));
+    _mm_storeu_si128((__m128i*)buffer, _mm_or_si128(v, dashes));
+
+    /*
+     * Output bytes 16-31: a14 a15 - b0-b3 - b4-b11
+     */
+    dashes = _mm_setr_epi8(0, 0, '-', 0, 0, 0, 0, '-',
+                           0, 0, 0, 0, 0, 0, 0, 0);
+    v = _mm_or_si128
+        (
+            _mm_shuffle_epi8(a, _mm_setr_epi8(14, 15, Z, Z, Z, Z, Z, Z,
+                    Z, Z, Z, Z, Z, Z, Z, Z)),
+            _mm_shuffle_epi8(b, _mm_setr_epi8(Z, Z, Z, 0, 1, 2, 3, Z,
+                    4, 5, 6, 7, 8, 9, 10, 11))
+        );
+    _mm_storeu_si128((__m128i*)(buffer + 16), _mm_or_si128(v, dashes));
+
+    /*
+     * Output bytes 32-35: b12-b15
+     */
+    tail = _mm_extract_epi32(b, 3);
+    memcpy(buffer + 32, &tail, 4);
+}
+
+/*
+ * Converts 16 hexadecimal digits to nibbles, and packs them into 8 bytes (in
+ * the low half of the result).
+ *
+ * Returns -1 if any of the digits are invalid, 0 otherwise.
+ */
+__attribute__((target("sse4.1"), always_inline))
+static inline int unhex_sse41(__m128i v, __m128i *bytes)
+{
+    __m128i digit, letter, is_digit, is_letter;
+
+    digit = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+
+    letter = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)),
+            _mm_set1_epi8('a'));
+    is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+
+    if (0xffff != _mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)))
+        return -1;
+
+    v = _mm_blendv_epi8
+        (
+            _mm_add_epi8(letter, _mm_set1_epi8(10)),
+            digit,
+            is_digit
+        );
+
+    /*
+     * Each pair of nibbles becomes (high * 16 + low) in a 16-bit lane.
+     */
+    v = _mm_maddubs_epi16(v, _mm_setr_epi8(16, 1, 16, 1, 16, 1, 16, 1,
+                16, 1, 16, 1, 16, 1, 16, 1));
+    *bytes = _mm_packus_epi16(v, v);
+
+    return 0;
+}
+
+__attribute__((target("sse4.1")))
+static int parse_sse41(const char *text, unsigned char *uuid)
+{
+    __m128i c0, c1, c2, dashes, a, b;
+    int tail;
+
+    c0 = _mm_loadu_si128((const __m128i*)text);
+    c1 = _mm_loadu_si128((const __m128i*)(text + 16));
+    memcpy(&tail, text + 32, 4);
+    c2 = _mm_cvtsi32_si128(tail);
+
+    /*
+     * The dashes are at offsets 8 and 13 of c0, and 2 and 7 of c1.
+     */
+    dashes = _mm_unpacklo_epi64
+             (
+                 _mm_shuffle_epi8(c0, _mm_setr_epi8(8, 13, Z, Z, Z, Z, Z, Z,
+                         Z, Z, Z, Z, Z, Z, Z, Z)),
+                 _mm_shuffle_epi8(c1, _mm_setr_epi8(2, 7, Z, Z, Z, Z, Z, Z,
+                         Z, Z, Z, Z, Z, Z, Z, Z))
+             );
+    if (0xffff != _mm_movemask_epi8(_mm_cmpeq_epi8(dashes,
+                    _mm_setr_epi8('-', '-', 0, 0, 0, 0, 0, 0,
+                                  '-', '-', 0, 0, 0, 0, 0, 0))))
+    {
+        return -1;
+    }
+
+    /*
+     * The digits of bytes 0-7: c0[0-7], c0[9-12], c0[14-15], c1[0-1].
+     */
+    a = _mm_or_si128
+        (
+            _mm_shuffle_epi8(c0, _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                    9, 10, 11, 12, 14, 15, Z, Z)),
+            _mm_shuffle_epi8(c1, _mm_setr_epi8(Z, Z, Z, Z, Z, Z, Z, Z,
+                    Z, Z, Z, Z, Z, Z, 0, 1))
+        );
+
+    /*
+     * The digits of bytes 8-15: c1[3-6], c1[8-15], c2[0-3].
+     */
+    b = _mm_or_si128
+        (
+            _mm_shuffle_epi8(c1, _mm_setr_epi8(3, 4, 5, 6, 8, 9, 10, 11,
+                    12, 13, 14, 15, Z, Z, Z, Z)),
+            _mm_shuffle_epi8(c2, _mm_setr_epi8(Z, Z, Z, Z, Z, Z, Z, Z,
+                    Z, Z, Z, Z, 0, 1, 2, 3))
+        );
+
+    if (-1 == unhex_sse41(a, &a) || -1 == unhex_sse41(b, &b)) return -1;
+
+    _mm_storeu_si128((__m128i*)uuid, _mm_unpacklo_epi64(a, b));
+
+    return 0;
+}
+
+#undef Z
+#endif
@@ -0,0 +1,952 @@
+#include "tioc.h"
+#include "internal.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/*******************************************************************************
+ * TYPES
+ ******************************************************************************/
+
+struct tioc_writer
+{
+    int fd;
+    char *buffer;
+    size_t size;
+    size_t used;
+
+    /*
+     * Set for TIOC_ENCODING_BINARY, in which case labels holds the labels
+     * defined so far, indexed by id.
+     */
+    int binary;
+    tioc_label_t *labels;
+    size_t label_count;
+    size_t label_capacity;
+
+    /*
+     * Set for TIOC_ENCODING_CHECKED, in which case record is the offset in the
+     * buffer of the start of the current field, and crc is the checksum of
+     * any part of it that has already been written.
+     */
+    int checked;
+    size_t record;
+    uint32_t crc;
+
+    /*
+     * Set for writers opened with tioc_writer_open_async(), in which case
+     * buffer belongs to it.
+     */
+    struct tioc_async *async;
+};
+
+/*
+ * The default size of the output buffer.
+ */
+#define WRITER_DEFAULT_SIZE (64 * 1024)
+
+/*
+ * The alignment of the output buffer.  Page alignment keeps the buffer usable
+ * with O_DIRECT descriptors.
+ */
+#define WRITER_ALIGNMENT 4096
+
+/*
+ * The largest possible record header: the label, a colon, a length of up to
+ * TIOC_UNSIGNED_MAX digits and a second colon.  This only sizes the smallest
+ * buffer allowed; records reserve room by their actual sizes, and the largest
+ * (a UUID record under the longest label) fits in twice this many bytes.
+ */
+#define WRITER_RECORD_MAX (TIOC_LABEL_MAX + TIOC_UNSIGNED_MAX + 2)
+
+/*******************************************************************************
+ * WRITER FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+/*
+ * Writes all count iovecs to the file descriptor, retrying on partial writes
+ * and EINTR.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int write_all(int fd, struct iovec *iov, int count);
+
+/*
+ * Makes sure that at least size bytes are free in the buffer, flushing it if
+ * necessary.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int reserve(tioc_writer_t *writer, size_t size);
+
+/*
+ * Starts writing an asynchronous writer's buffer, and moves on to the next.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int submit(tioc_writer_t *writer);
+
+/*
+ * For checked data, adds the part of the current field that is in the buffer
+ * to its checksum, before the buffer is written.
+ */
+static void fold(tioc_writer_t *writer);
+
+/*
+ * Appends "<label>:" to the buffer or, for binary, the tag of a field of the
+ * kind given (preceded by a definition of the label if this is its first
+ * use), after reserving room for it plus extra bytes.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int begin_record
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    enum tioc_kind kind,
+    size_t extra,
+    const char *caller
+);
+
+/*
+ * Ends a record with a newline (for text) or its checksum (for checked data).
+ * Room for a newline must have been reserved.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int end_record(tioc_writer_t *writer, const char *caller);
+
+/*
+ * Adds the size bytes of fd, which are about to be written to the writer's
+ * file directly, to the current field's checksum.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int fold_fd(tioc_writer_t *writer, int fd, size_t size);
+
+/*
+ * Sets *id to the binary id of the label, defining it if necessary.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int label_id
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    size_t *id,
+    int *defined
+);
+
+/*
+ * Appends a payload length to the buffer: for text, in decimal and followed by
+ * a colon; for binary, as a varint.  Room for it must have been reserved.
+ */
+static void append_length(tioc_writer_t *writer, size_t size);
+
+/*
+ * Appends the length, and then as much of the payload as fits, to the buffer,
+ * writing the rest directly.  For text, the length is decimal and followed by
+ * a colon; for binary, it is a varint.
+ *
+ * Returns -1 on failure, 0 on success.
+ */
+static int append_payload
+(
+    tioc_writer_t *writer,
+    const char *data,
+    size_t size,
+    int counted,
+    const char *caller
+);
+
+/*******************************************************************************
+ * WRITER FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+tioc_writer_t *tioc_writer_open(int fd, size_t size)
+{
+    return tioc_writer_open_encoding(fd, size, TIOC_ENCODING_TEXT);
+}
+
+tioc_writer_t *tioc_writer_open_encoding
+(
+    int fd,
+    size_t size,
+    tioc_encoding_t encoding
+)
+{
+    tioc_writer_t *writer = NULL;
+    void *buffer = NULL;
+
+    if (-1 == fd)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_writer_open(): Invalid 'fd' argument."
+        );
+        return NULL;
+    }
+
+    if (TIOC_ENCODING_TEXT != encoding && TIOC_ENCODING_BINARY != encoding &&
+        TIOC_ENCODING_CHECKED != encoding)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_writer_open(): Invalid 'encoding' argument."
+        );
+        return NULL;
+    }
+
+    if (!size) size = WRITER_DEFAULT_SIZE;
+    if (size < 2 * WRITER_RECORD_MAX) size = 2 * WRITER_RECORD_MAX;
+
+    if (!(writer = malloc(sizeof(*writer))))
+    {
+        tioc_e(TIOC_ERROR_MEMORY, "tioc_writer_open(): malloc() failed.");
+        return NULL;
+    }
+
+    if (posix_memalign(&buffer, WRITER_ALIGNMENT, size))
+    {
+        tioc_e
+        (
+            TIOC_ERROR_MEMORY,
+            "tioc_writer_open(): posix_memalign() failed."
+        );
+        free(writer);
+        return NULL;
+    }
+
+    writer->fd = fd;
+    writer->buffer = buffer;
+    writer->size = size;
+    writer->used = 0;
+    writer->binary = TIOC_ENCODING_TEXT != encoding;
+    writer->labels = NULL;
+    writer->label_count = 0;
+    writer->label_capacity = 0;
+    writer->checked = TIOC_ENCODING_CHECKED == encoding;
+    writer->record = 0;
+    writer->crc = 0;
+    writer->async = NULL;
+
+    if (writer->binary)
+    {
+        memcpy(writer->buffer, writer->checked ? TIOC_CHECKED_MAGIC
+                : TIOC_BINARY_MAGIC, TIOC_BINARY_MAGIC_LENGTH);
+        writer->used = TIOC_BINARY_MAGIC_LENGTH;
+    }
+
+    return writer;
+}
+
+tioc_writer_t *tioc_writer_open_async
+(
+    int fd,
+    size_t size,
+    size_t buffers,
+    tioc_encoding_t encoding,
+    tioc_write_completion_t completion,
+    void *context
+)
+{
+    tioc_writer_t *writer;
+    struct tioc_async *async;
+
+    if (!(writer = tioc_writer_open_encoding(fd, size, encoding))) return NULL;
+
+    if (!(async = tioc_async_create(fd, writer->size, buffers, completion,
+            context)))
+    {
+        tioc_w("tioc_writer_open_async(): Unable to create buffers.");
+        free(writer->buffer);
+        free(writer);
+        return NULL;
+    }
+
+    /*
+     * Move anything already written (i.e. the binary magic) to the first of
+     * the asynchronous buffers.
+     */
+    memcpy(tioc_async_buffer(async), writer->buffer, writer->used);
+    free(writer->buffer);
+
+    writer->async = async;
+    writer->buffer = tioc_async_buffer(async);
+    writer->size = tioc_async_size(async);
+
+    return writer;
+}
+
+int tioc_writer_close(tioc_writer_t *writer)
+{
+    int rc = 0;
+
+    if (!writer) return 0;
+
+    if (-1 == tioc_writer_flush(writer)) rc = -1;
+
+    if (writer->async)
+    {
+        if (-1 == tioc_async_destroy(writer->async)) rc = -1;
+    }
+    else
+    {
+        free(writer->buffer);
+    }
+
+    if (-1 == close(writer->fd))
+    {
+        tioc_e(TIOC_ERROR_IO, "tioc_writer_close(): close() failed.");
+        rc = -1;
+    }
+
+    free(writer->labels);
+    free(writer);
+
+    return rc;
+}
+
+int tioc_writer_flush(tioc_writer_t *writer)
+{
+    struct iovec iov;
+
+    if (!writer)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_writer_flush(): Invalid 'writer' argument."
+        );
+        return -1;
+    }
+
+    if (writer->async)
+    {
+        if (-1 == submit(writer) || -1 == tioc_async_drain(writer->async))
+        {
+            tioc_w("tioc_writer_flush(): Unable to write buffers.");
+            return -1;
+        }
+
+        return 0;
+    }
+
+    if (!writer->used) return 0;
+
+    fold(writer);
+
+    iov.iov_base = writer->buffer;
+    iov.iov_len = writer->used;
+
+    if (-1 == write_all(writer->fd, &iov, 1))
+    {
+        tioc_e(TIOC_ERROR_IO, "tioc_writer_flush(): write() failed.");
+        return -1;
+    }
+
+    writer->used = 0;
+    return 0;
+}
+
+static int write_all(int fd, struct iovec *iov, int count)
+{
+    ssize_t n;
+    size_t done;
+
+    while (count)
+    {
+        if (-1 == (n = writev(fd, iov, count)))
+        {
+            if (EINTR == errno) continue;
+            return -1;
+        }
+
+        done = (size_t)n;
+        while (count && done >= iov->iov_len)
+        {
+            done -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+
+        if (count)
+        {
+            iov->iov_base = (char*)iov->iov_base + done;
+            iov->iov_len -= done;
+        }
+    }
+
+    return 0;
+}
+
+static int submit(tioc_writer_t *writer)
+{
+    fold(writer);
+
+    if (-1 == tioc_async_submit(writer->async, writer->used, &writer->buffer))
+    {
+        return -1;
+    }
+
+    writer->used = 0;
+    return 0;
+}
+
+static void fold(tioc_writer_t *writer)
+{
+    if (!writer->checked) return;
+
+    writer->crc = tioc_crc32c(writer->crc, writer->buffer + writer->record,
+            writer->used - writer->record);
+    writer->record = 0;
+}
+
+static int reserve(tioc_writer_t *writer, size_t size)
+{
+    if (writer->size - writer->used >= size) return 0;
+
+    if (writer->async) return submit(writer);
+
+    return tioc_writer_flush(writer);
+}
+
+static int begin_record
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    enum tioc_kind kind,
+    size_t extra,
+    const char *caller
+)
+{
+    size_t id;
+    int defined;
+    char *p;
+
+    if (!writer)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "%s(): Invalid 'writer' argument.", caller);
+        return -1;
+    }
+
+    if (!label)
+    {
+        tioc_e(TIOC_ERROR_ARGUMENT, "%s(): Invalid 'label' argument.", caller);
+        return -1;
+    }
+
+    /*
+     * A binary definition and tag take no more room than the label, a colon
+     * and three varints.
+     */
+    if (-1 == reserve(writer, label->length + 3 * TIOC_VARINT_MAX + extra))
+    {
+        tioc_w("%s(): Unable to flush buffer.", caller);
+        return -1;
+    }
+
+    writer->record = writer->used;
+    writer->crc = 0;
+
+    if (!writer->binary)
+    {
+        memcpy(writer->buffer + writer->used, label->prefix, label->length);
+        writer->used += label->length;
+        return 0;
+    }
+
+    if (-1 == label_id(writer, label, &id, &defined))
+    {
+        tioc_w("%s(): Unable to define label.", caller);
+        return -1;
+    }
+
+    p = writer->buffer + writer->used;
+
+    if (defined)
+    {
+        p += tioc_format_varint(p, (unsigned long long)id << TIOC_KIND_BITS |
+                TIOC_KIND_DEFINE);
+        p += tioc_format_varint(p, label->length - 1);
+        memcpy(p, label->prefix, label->length - 1);
+        p += label->length - 1;
+    }
+
+    p += tioc_format_varint(p, (unsigned long long)id << TIOC_KIND_BITS |
+            kind);
+    writer->used = p - writer->buffer;
+
+    return 0;
+}
+
+static int end_record(tioc_writer_t *writer, const char *caller)
+{
+    char *p;
+
+    if (!writer->binary)
+    {
+        writer->buffer[writer->used++] = '\n';
+        return 0;
+    }
+
+    if (!writer->checked) return 0;
+
+    if (-1 == reserve(writer, TIOC_CHECKSUM_LENGTH))
+    {
+        tioc_w("%s(): Unable to flush buffer.", caller);
+        return -1;
+    }
+
+    fold(writer);
+
+    p = writer->buffer + writer->used;
+    p[0] = (char)writer->crc;
+    p[1] = (char)(writer->crc >> 8);
+    p[2] = (char)(writer->crc >> 16);
+    p[3] = (char)(writer->crc >> 24);
+    writer->used += TIOC_CHECKSUM_LENGTH;
+
+    return 0;
+}
+
+static int fold_fd(tioc_writer_t *writer, int fd, size_t size)
+{
+    void *mapping;
+
+    if (!writer->checked || !size) return 0;
+
+    mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == mapping)
+    {
+        tioc_e(TIOC_ERROR_IO, "fold_fd(): Unable to map descriptor %d.", fd);
+        return -1;
+    }
+
+    writer->crc = tioc_crc32c(writer->crc, mapping, size);
+    munmap(mapping, size);
+
+    return 0;
+}
+
+static int label_id
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    size_t *id,
+    int *defined
+)
+{
+    tioc_label_t *labels;
+    size_t i;
+
+    for (i = 0; i < writer->label_count; ++i)
+    {
+        if (label->hash == writer->labels[i].hash &&
+            label->length == writer->labels[i].length &&
+            !memcmp(label->prefix, writer->labels[i].prefix, label->length))
+        {
+            *id = i;
+            *defined = 0;
+            return 0;
+        }
+    }
+
+    if (writer->label_count == writer->label_capacity)
+    {
+        writer->label_capacity = writer->label_capacity
+                               ? 2 * writer->label_capacity
+                               : 16;
+
+        labels = realloc(writer->labels,
+                writer->label_capacity * sizeof(*labels));
+        if (!labels)
+        {
+            tioc_e(TIOC_ERROR_MEMORY, "label_id(): realloc() failed.");
+            return -1;
+        }
+
+        writer->labels = labels;
+    }
+
+    writer->labels[writer->label_count] = *label;
+    *id = writer->label_count++;
+    *defined = 1;
+
+    return 0;
+}
+
+static void append_length(tioc_writer_t *writer, size_t size)
+{
+    if (writer->binary)
+    {
+        writer->used += tioc_format_varint(writer->buffer + writer->used, size);
+        return;
+    }
+
+    writer->used += tioc_format_unsigned(writer->buffer + writer->used, size);
+    writer->buffer[writer->used++] = ':';
+}
+
+static int append_payload
+(
+    tioc_writer_t *writer,
+    const char *data,
+    size_t size,
+    int counted,
+    const char *caller
+)
+{
+    struct iovec iov[2];
+    size_t n;
+
+    if (counted) append_length(writer, size);
+
+    /*
+     * Leave room for the newline.
+     */
+    if (writer->size - writer->used > size)
+    {
+        memcpy(writer->buffer + writer->used, data, size);
+        writer->used += size;
+        return 0;
+    }
+
+    /*
+     * An asynchronous writer's buffers cannot be written around, so the
+     * payload is copied through them.
+     */
+    if (writer->async)
+    {
+        while (writer->size - writer->used <= size)
+        {
+            n = writer->size - writer->used;
+            memcpy(writer->buffer + writer->used, data, n);
+            writer->used += n;
+            data += n;
+            size -= n;
+
+            if (-1 == submit(writer))
+            {
+                tioc_w("%s(): Unable to write buffer.", caller);
+                return -1;
+            }
+        }
+
+        memcpy(writer->buffer + writer->used, data, size);
+        writer->used += size;
+        return 0;
+    }
+
+    fold(writer);
+    if (writer->checked) writer->crc = tioc_crc32c(writer->crc, data, size);
+
+    iov[0].iov_base = writer->buffer;
+    iov[0].iov_len = writer->used;
+    iov[1].iov_base = (char*)data;
+    iov[1].iov_len = size;
+
+    if (-1 == write_all(writer->fd, iov, 2))
+    {
+        tioc_e(TIOC_ERROR_IO, "%s(): writev() failed.", caller);
+        return -1;
+    }
+
+    writer->used = 0;
+    return 0;
+}
+
+int tioc_writer_write_unsigned
+(
+    tioc_writer_t *writer,
+    const char *label,
+    unsigned long long value
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_writer_write_unsigned_l(writer, &l, value);
+}
+
+int tioc_writer_write_unsigned_l
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    unsigned long long value
+)
+{
+    if (-1 == begin_record(writer, label, TIOC_KIND_UNSIGNED,
+                TIOC_UNSIGNED_MAX + 1, "tioc_writer_write_unsigned_l"))
+    {
+        return -1;
+    }
+
+    if (writer->binary)
+    {
+        writer->used += tioc_format_varint(writer->buffer + writer->used,
+                value);
+    }
+    else
+    {
+        writer->used += tioc_format_unsigned(writer->buffer + writer->used,
+                value);
+    }
+
+    return end_record(writer, "tioc_writer_write_unsigned_l");
+}
+
+int tioc_writer_write_uuid
+(
+    tioc_writer_t *writer,
+    const char *label,
+    uuid_t uuid
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_writer_write_uuid_l(writer, &l, uuid);
+}
+
+int tioc_writer_write_uuid_l
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    uuid_t uuid
+)
+{
+    if (-1 == begin_record(writer, label, TIOC_KIND_UUID,
+                TIOC_UUID_LENGTH + 1, "tioc_writer_write_uuid_l"))
+    {
+        return -1;
+    }
+
+    if (writer->binary)
+    {
+        memcpy(writer->buffer + writer->used, uuid, sizeof(uuid_t));
+        writer->used += sizeof(uuid_t);
+    }
+    else
+    {
+        tioc_format_uuid(writer->buffer + writer->used, uuid);
+        writer->used += TIOC_UUID_LENGTH;
+    }
+
+    return end_record(writer, "tioc_writer_write_uuid_l");
+}
+
+int tioc_writer_write_string
+(
+    tioc_writer_t *writer,
+    const char *label,
+    const char *string
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_writer_write_string_l(writer, &l, string);
+}
+
+int tioc_writer_write_string_l
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    const char *string
+)
+{
+    if (!string)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_writer_write_string_l(): Invalid 'string' argument."
+        );
+        return -1;
+    }
+
+    return tioc_writer_write_blob_l(writer, label, string, strlen(string));
+}
+
+int tioc_writer_write_blob
+(
+    tioc_writer_t *writer,
+    const char *label,
+    const char *blob,
+    size_t size
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_writer_write_blob_l(writer, &l, blob, size);
+}
+
+int tioc_writer_write_blob_l
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    const char *blob,
+    size_t size
+)
+{
+    if (!blob && size)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_writer_write_blob_l(): Invalid 'blob' argument."
+        );
+        return -1;
+    }
+
+    if (-1 == begin_record(writer, label, TIOC_KIND_BLOB,
+                TIOC_UNSIGNED_MAX + 2, "tioc_writer_write_blob_l") ||
+        -1 == append_payload(writer, blob, size, 1,
+                "tioc_writer_write_blob_l"))
+    {
+        return -1;
+    }
+
+    return end_record(writer, "tioc_writer_write_blob_l");
+}
+
+int tioc_writer_write_blob_fd
+(
+    tioc_writer_t *writer,
+    const char *label,
+    int fd
+)
+{
+    tioc_label_t l;
+
+    if (-1 == tioc_label_init(&l, label)) return -1;
+
+    return tioc_writer_write_blob_fd_l(writer, &l, fd);
+}
+
+int tioc_writer_write_blob_fd_l
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    int fd
+)
+{
+    size_t size;
+
+    if (-1 == tioc_fd_size(fd, &size, "tioc_writer_write_blob_fd_l") ||
+        -1 == begin_record(writer, label, TIOC_KIND_BLOB,
+                TIOC_UNSIGNED_MAX + 2, "tioc_writer_write_blob_fd_l"))
+    {
+        return -1;
+    }
+
+    append_length(writer, size);
+
+    if (-1 == tioc_writer_flush(writer) ||
+        -1 == fold_fd(writer, fd, size) ||
+        -1 == tioc_copy_range(fd, 0, writer->fd, size,
+                "tioc_writer_write_blob_fd_l"))
+    {
+        return -1;
+    }
+
+    if (writer->async) tioc_async_resume(writer->async);
+
+    return end_record(writer, "tioc_writer_write_blob_fd_l");
+}
+
+int tioc_writer_write_raw_l
+(
+    tioc_writer_t *writer,
+    const tioc_label_t *label,
+    const char *data,
+    size_t size
+)
+{
+    if (!data && size)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_writer_write_raw_l(): Invalid 'data' argument."
+        );
+        return -1;
+    }
+
+    if (-1 == begin_record(writer, label, TIOC_KIND_RAW,
+                TIOC_UNSIGNED_MAX + 2, "tioc_writer_write_raw_l") ||
+        -1 == append_payload(writer, data, size, writer->binary,
+                "tioc_writer_write_raw_l"))
+    {
+        return -1;
+    }
+
+    return end_record(writer, "tioc_writer_write_raw_l");
+}
+
+int tioc_writer_write_record
+(
+    tioc_writer_t *writer,
+    const tioc_schema_t *schema,
+    const void *record
+)
+{
+    const struct tioc_schema_field *field;
+    const char *value;
+    size_t i, size;
+    int rc = 0;
+
+    if (!schema || !record)
+    {
+        tioc_e
+        (
+            TIOC_ERROR_ARGUMENT,
+            "tioc_writer_write_record(): Invalid argument."
+        );
+        return -1;
+    }
+
+    for (i = 0; 0 == rc && i < schema->count; ++i)
+    {
+        field = &schema->fields[i];
+        value = (const char*)record + field->offset;
+
+        switch (field->type)
+        {
+            case TIOC_TYPE_UNSIGNED:
+                rc = tioc_writer_write_unsigned_l(writer, &field->label,
+                        *(const unsigned long long*)value);
+                break;
+
+            case TIOC_TYPE_UUID:
+                rc = tioc_writer_write_uuid_l(writer, &field->label,
+                        (unsigned char*)value);
+                break;
+
+            case TIOC_TYPE_STRING:
+                rc = tioc_writer_write_string_l(writer, &field->label,
+                        *(const char * const *)value);
+                break;
+
+            case TIOC_TYPE_BLOB:
+                size = *(const size_t*)((const char*)record +
+                        field->size_offset);
+                rc = tioc_writer_write_blob_l(writer, &field->label,
+                        *(const char * const *)value, size);
+                break;
+        }
+    }
+
+    return rc;
+}